@@ -4,7 +4,12 @@
 #include "Shielding.hh"
 
 #include "G4PeriodicBoundaryPhysics.hh"
+
+#ifdef G4MULTITHREADED
+#include "G4MTRunManager.hh"
+#else
 #include "G4RunManager.hh"
+#endif
 
 #ifdef G4UI_USE
 #include "G4UIExecutive.hh"
@@ -19,7 +24,12 @@
 int main(int argc, char** argv)
 {
 
+#ifdef G4MULTITHREADED
+  G4MTRunManager* run_manager = new G4MTRunManager();
+  run_manager->SetNumberOfThreads(G4Threading::G4GetNumberOfCores());
+#else
   G4RunManager* run_manager = new G4RunManager();
+#endif
 
   run_manager->SetUserInitialization(new DetectorConstruction());
 
@@ -1,22 +1,119 @@
 #pragma once
 #include "G4LogicalVolume.hh"
+#include "G4PeriodicCell.hh"
+
+#include <array>
+#include <map>
+
+class G4Track;
+class G4VTouchable;
 
 /*a derived class of logical volume that is used to indicate whether
-periodic boundary conditions should be applied to this volume*/
+periodic boundary conditions should be applied to this volume
+
+a periodic volume may be placed anywhere in the geometry, and several may be
+placed in one world. each repeats along the lattice of its own solid, and may
+be given its own periodic axes and boundary condition; those it is not given
+are the ones of G4PeriodicBoundaryPhysics. single faces may be given a kind of
+their own, so that a cell reduced by a mirror symmetry reflects off its
+symmetry planes and cycles through its other faces. a cyclic face must be
+paired with a cyclic opposite face
+
+a cyclic volume may also stand for a finite array of identical cells, tiled
+virtually from its single placement. the cells are numbered from 0 to n-1
+along each lattice vector, and a track is in the start cell until it first
+cycles. crossing a face at the edge of the array moves the track to where it
+is in the unfolded space, in the mother volume outside the array, or kills it
+there if the edge is set to absorb. outside the one cell placed the footprint
+of the array is only the mother volume, which a track that has left sees if it
+comes back. chosen cells may be replaced by
+a defect, another periodic volume of the same shape placed once elsewhere in
+the geometry, which a track enters when it cycles into that cell. the memory
+used does not depend on the number of cells*/
 
 class G4LogicalVolumePeriodic : public G4LogicalVolume {
     public:
+        typedef std::array<G4int, 3> CellIndex;
+
         G4LogicalVolumePeriodic(G4VSolid* pSolid,
             G4Material* pMaterial,
-            const G4String& name) : 
+            const G4String& name) :
             G4LogicalVolume( pSolid, pMaterial, name){
-                //
+                has_axes = false;
+                has_kind = false;
+                periodic_x = periodic_y = true;
+                periodic_z = false;
+                kind = fCyclicBoundary;
+                cyclic_faces = reflecting_faces = open_faces = 0;
+                tiling = start_cell = CellIndex{{0, 0, 0}};
+                array = NULL;
+                kill_at_edge = false;
             };
-        ~G4LogicalVolumePeriodic(){};    
-        
+        ~G4LogicalVolumePeriodic(){};
+
         G4bool IsExtended() const { return true; }
         // Return true if it is not a base-class object.
 
-        
-};
+        void SetPeriodicAxes(G4bool per_x, G4bool per_y, G4bool per_z)
+        { periodic_x = per_x; periodic_y = per_y; periodic_z = per_z; has_axes = true; }
+        G4bool GetPeriodicAxes(G4bool& per_x, G4bool& per_y, G4bool& per_z) const
+        { per_x = periodic_x; per_y = periodic_y; per_z = periodic_z; return has_axes; }
+        // Returns false if the volume uses the axes of the physics.
+
+        void SetBoundaryKind(G4PeriodicBoundaryKind boundary) { kind = boundary; has_kind = true; }
+        G4bool GetBoundaryKind(G4PeriodicBoundaryKind& boundary) const
+        { boundary = kind; return has_kind; }
+        // Returns false if the volume uses the boundary condition of the physics.
 
+        void SetFaceKind(G4int faces, G4PeriodicBoundaryKind boundary);
+        // Sets the boundary condition of the faces given as G4PeriodicFace
+        // bits, overriding the axes and the kind of the volume.
+        G4bool GetFaceKinds(G4int& cyclic, G4int& reflecting, G4int& open) const
+        { cyclic = cyclic_faces; reflecting = reflecting_faces; open = open_faces;
+          return (cyclic_faces | reflecting_faces | open_faces) != 0; }
+        // Returns false if no face has a kind of its own.
+
+        void SetTiling(G4int n_a, G4int n_b, G4int n_c);
+        // Number of cells of the array along each lattice vector, 0 for no
+        // edge along it.
+        void SetStartCell(G4int i, G4int j, G4int k);
+        // Cell of a track that has not cycled yet, 0 0 0 by default.
+        void SetDefect(G4int i, G4int j, G4int k, G4LogicalVolumePeriodic* defect);
+        // Replaces a cell of the array with the defect volume.
+        void SetKillAtEdge(G4bool kill) { kill_at_edge = kill; }
+        G4bool GetKillAtEdge() const { return kill_at_edge; }
+        // Kills a track at the edge of the array instead of moving it out,
+        // counting its energy in the statistics.
+
+        G4bool IsTiled() const;
+        const CellIndex& GetTiling() const { return tiling; }
+        const CellIndex& GetStartCell() const { return start_cell; }
+        const std::map<CellIndex, G4LogicalVolumePeriodic*>& GetDefects() const
+        { return defects; }
+        G4bool IsInArray(const CellIndex& cell) const;
+
+        const G4LogicalVolumePeriodic* GetArray() const { return array ? array : this; }
+        // The volume whose tiling a defect belongs to, the volume itself
+        // otherwise.
+
+        CellIndex GetCellIndex(const G4Track* track) const;
+        // Returns the cell of the array a track in the volume, or in one of
+        // its defects, is in.
+
+        static const G4LogicalVolumePeriodic* Find(const G4VTouchable* touchable);
+        // Returns the innermost periodic volume containing a touchable, for
+        // sensitive detectors scoring per cell, NULL if there is none.
+
+    private:
+        G4bool has_axes;
+        G4bool periodic_x, periodic_y, periodic_z;
+        G4bool has_kind;
+        G4PeriodicBoundaryKind kind;
+        G4int cyclic_faces, reflecting_faces, open_faces;
+
+        CellIndex tiling;
+        CellIndex start_cell;
+        std::map<CellIndex, G4LogicalVolumePeriodic*> defects;
+        const G4LogicalVolumePeriodic* array;
+        G4bool kill_at_edge;
+};
@@ -1,9 +1,13 @@
 #pragma once
 
 #include "globals.hh"
+#include "G4TouchableHandle.hh"
 #include "G4VParticleChange.hh"
 
 class G4DynamicParticle;
+class G4Material;
+class G4MaterialCutsCouple;
+class G4VSensitiveDetector;
 
 class G4ParticleChangeForPeriodic : public G4VParticleChange {
 
@@ -30,6 +34,14 @@ public:
   void ProposePosition(const G4ThreeVector& pos);
   void ProposePosition(G4double x, G4double y, G4double z);
 
+  const G4TouchableHandle& GetProposedTouchableHandle() const;
+  G4bool IsTouchableProposed() const;
+  void ProposeTouchableHandle(const G4TouchableHandle& touchable);
+  // Hands the touchable located by the process after moving the particle to
+  // the post step point, together with the material, couple and sensitive
+  // detector of its volume, so that the stepping manager does not see the
+  // touchable located by transportation before the move.
+
   const G4Track* GetCurrentTrack() const;
 
   virtual void DumpInfo() const;
@@ -47,6 +59,12 @@ private:
   G4ThreeVector proposedPolarization;
   G4ThreeVector proposedPosition;
 
+  G4TouchableHandle proposedTouchableHandle;
+  const G4Material* proposedMaterial;
+  const G4MaterialCutsCouple* proposedMaterialCutsCouple;
+  G4VSensitiveDetector* proposedSensitiveDetector;
+  G4bool isTouchableProposed;
+
 };
 
 inline
@@ -123,9 +141,21 @@ inline void G4ParticleChangeForPeriodic::InitializeForPostStep(const G4Track& tr
   proposedMomentumDirection = track.GetMomentumDirection();
   proposedPolarization = track.GetPolarization();
   proposedPosition = track.GetPosition();
+  isTouchableProposed = false;
   currentTrack = &track;
 }
 
+inline
+ const G4TouchableHandle& G4ParticleChangeForPeriodic::GetProposedTouchableHandle() const
+{
+  return proposedTouchableHandle;
+}
+
+inline G4bool G4ParticleChangeForPeriodic::IsTouchableProposed() const
+{
+  return isTouchableProposed;
+}
+
 
 inline const G4Track* G4ParticleChangeForPeriodic::GetCurrentTrack() const
 {
@@ -3,11 +3,17 @@
 #include "globals.hh"
 #include "G4LogicalVolumePeriodic.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4ThreeVector.hh"
+#include "G4Transform3D.hh"
 
 #include <map>
 #include <string>
 using namespace std;
 
+class G4Box;
+class G4Region;
+class G4VSolid;
+
 class G4PeriodicBoundaryBuilder
 {
 
@@ -17,7 +23,66 @@ public:
   ~G4PeriodicBoundaryBuilder();
 
   G4LogicalVolume *Construct(G4LogicalVolume *);
+  // Places a periodic box the size of the (box) world volume inside it, and
+  // enlarges the world volume slightly so that they share no surface.
+
+  G4LogicalVolume *ConstructHexagonal(G4LogicalVolume *, G4double apothem,
+    G4double half_z, const G4ThreeVector &origin = G4ThreeVector());
+  // Places a periodic hexagonal prism along z, with its sides at apothem
+  // from the axis and two sides normal to x, at origin in the world volume.
+  // The world volume is enlarged if needed to contain it.
+
+  G4LogicalVolume *ConstructTriclinic(G4LogicalVolume *, const G4ThreeVector &a,
+    const G4ThreeVector &b, const G4ThreeVector &c,
+    const G4ThreeVector &origin = G4ThreeVector());
+  // Places the periodic parallelepiped spanned by three lattice vectors,
+  // centred at origin in the world volume. a must lie along x and b in the
+  // xy plane, as for a G4Para.
+
+  G4LogicalVolume *ConstructWedge(G4LogicalVolume *, G4int n_fold,
+    G4double r_min, G4double r_max, G4double half_z,
+    const G4ThreeVector &origin = G4ThreeVector());
+  G4LogicalVolume *ConstructWedge(G4LogicalVolume *, G4int n_fold,
+    G4int num_z_planes, const G4double z_plane[], const G4double r_inner[],
+    const G4double r_outer[], const G4ThreeVector &origin = G4ThreeVector());
+  // Places the 1/n_fold sector of a tube, or of a polycone, about the z
+  // axis through origin in the world volume, bisected by the x axis. The
+  // world volume is enlarged if needed to contain it. A particle leaving
+  // through one side of the sector is rotated onto the other.
+
+  G4LogicalVolume *ConstructArray(G4LogicalVolume *, G4int n_x, G4int n_y);
+  // Divides the (box) world volume laterally into a virtual array of n_x by
+  // n_y cells, and places the one cell of the middle of the array, the start
+  // cell. The world volume is enlarged as by Construct.
+
+  G4LogicalVolume *ConstructSymmetric(G4LogicalVolume *, G4LogicalVolume *full_cell,
+    G4bool mirror_x, G4bool mirror_y, G4bool mirror_z = false,
+    const G4ThreeVector &origin = G4ThreeVector());
+  // Places the half, quarter or eighth of the (box) full cell on the plus
+  // side of its mirror planes through the centre, whose centre is at origin
+  // in the world volume. Both faces along a mirrored axis reflect, the plus
+  // face of a periodic cell being a mirror plane too; that of an axis the
+  // cell is not periodic along is opened with SetFaceKind. The daughters of
+  // the full cell are moved into the reduced cell, and those cut by a mirror
+  // plane are cut, so they must be symmetric about it. A logical volume
+  // placed only there is cut in place, one placed elsewhere too is cut in a
+  // copy named with "_reduced", which keeps its sensitive detector and field
+  // manager. The full cell is left empty.
+
+  G4Region *ConstructEnvelope(const G4String &name = "periodic_envelope");
+  // Makes the periodic volume last constructed the root of a region, the
+  // envelope of G4PeriodicFastForwardModel.
 
 private:
+  G4Box *GetWorldBox(G4LogicalVolume *);
+  void CheckFold(G4int n_fold);
+  void EncloseCell(G4Box *world, const G4VSolid *cell, const G4ThreeVector &origin);
+  void ReduceDaughters(G4LogicalVolume *source, G4LogicalVolume *target,
+    const G4Transform3D &to_full, const G4ThreeVector &centre,
+    const G4bool mirror[3], G4Box *cut);
+  G4LogicalVolume *CloneVolume(G4LogicalVolume *lv, G4VSolid *solid);
+  G4LogicalVolume *PlaceCell(G4LogicalVolume *logical_world, G4VSolid *cell,
+    const G4ThreeVector &origin);
+
   G4LogicalVolumePeriodic *logical_periodic;
 };
@@ -1,24 +1,111 @@
 #pragma once
 
+#include "G4PeriodicBoundaryProcess.hh"
 #include "G4VPhysicsConstructor.hh"
 
-class G4PeriodicBoundaryProcess;
+#include <set>
+
+class G4PeriodicStatisticsMessenger;
+class G4ProcessManager;
+class G4VProcess;
+
+/*selects how the boundary condition is applied. fPeriodicBoundaryProcess adds
+a periodic boundary process to each particle, fPeriodicTransportation replaces
+the transportation of each particle by G4PeriodicTransportation, which wraps
+the particle within its own post step action. fPeriodicNavigator tracks every
+particle through the unfolded lattice with G4PeriodicNavigator, so that the
+periodic faces do not limit steps; it applies cyclic conditions only*/
+enum G4PeriodicBoundaryMode {
+  fPeriodicBoundaryProcess,
+  fPeriodicTransportation,
+  fPeriodicNavigator
+};
 
 class G4PeriodicBoundaryPhysics : public G4VPhysicsConstructor {
 
 public:
 
   G4PeriodicBoundaryPhysics(const G4String& name = "Periodic", bool per_x = true,
-    bool per_y = true, bool per_z = false, bool ref_walls = false);
+    bool per_y = true, bool per_z = false, bool ref_walls = false,
+    G4PeriodicBoundaryMode mode = fPeriodicBoundaryProcess);
   virtual ~G4PeriodicBoundaryPhysics();
 
+  void SetDispatchMode(G4PeriodicDispatchMode mode) { dispatch_mode = mode; }
+  // Default is fDispatchPeriodicFace, fDispatchEveryStep restores the
+  // behaviour of forcing the process on every step.
+
+  void SetRegion(const G4String& name) { region_name = name; }
+  // Limits the process to the volumes of a region.
+
+  void SetParticlePolicy(G4PeriodicParticlePolicy policy) { particle_policy = policy; }
+  void AddParticle(const G4String& name) { listed_particles.insert(name); }
+  void ExcludeParticle(const G4String& name) { excluded_particles.insert(name); }
+
+  void SetRecoveryDistance(G4double distance) { recovery_distance = distance; }
+  // Distance from a face within which a crossing is recovered.
+
+  void SetCrossingBudget(G4int n, G4PeriodicBudgetPolicy policy = fBudgetRoulette,
+    G4double survival = 0.5)
+  { crossing_budget = n; budget_policy = policy; survival_probability = survival; }
+  // Bounds the crossings of each track, see G4PeriodicBoundaryProcess.
+
+  void SetTrajectoryMode(G4PeriodicTrajectoryMode mode) { trajectory_mode = mode; }
+  // How cyclings are recorded in stored trajectories.
+
+  void SetWrappedSafety(G4bool wrap) { wrapped_safety = wrap; }
+  // Extends the safety across the periodic faces in the fPeriodicNavigator
+  // mode, so that multiple scattering does not limit steps near them.
+
+  void SetStatistics(G4bool counted) { statistics = counted; }
+  // Compiles the counters of each crossing and the timer of the statistics
+  // into the process, as by default. Without them only rare events are
+  // counted, see G4PeriodicBoundaryProcess.
+
+  static G4PeriodicBoundaryProcess* GetBoundaryProcess();
+  // The boundary process constructed for this thread, NULL in the
+  // fPeriodicNavigator mode.
+
 protected:
 
   virtual void ConstructParticle();
   virtual void ConstructProcess();
 
+  G4PeriodicBoundaryProcess* CreateProcess(const G4String& name) const;
+  // Returns the G4TPeriodicBoundaryProcess specialised for the periodic
+  // axes and boundary condition, with verbose output only if the verbose
+  // level is set when the process is constructed.
+
+  void ConstructNavigator();
+  // Installs G4PeriodicNavigator as the tracking navigator of this thread,
+  // and rebuilds transportation for every particle so that it uses it.
+
+  G4bool ReplaceTransportation(G4ProcessManager* pManager,
+    G4VProcess* transportation, G4VProcess* periodic) const;
+  // Puts the periodic transportation in place of the transportation of a
+  // particle, returns false if that is not a plain G4Transportation.
+
+  void DeleteTransportations(std::set<G4VProcess*>& removed);
+  // Deletes the replaced transportations that no particle holds any more.
+
 private:
+  G4PeriodicBoundaryMode boundary_mode;
   bool reflecting_walls;
   bool periodic_x, periodic_y, periodic_z;
 
+  G4PeriodicDispatchMode dispatch_mode;
+  G4String region_name;
+  G4PeriodicParticlePolicy particle_policy;
+  std::set<G4String> listed_particles;
+  std::set<G4String> excluded_particles;
+  G4double recovery_distance;
+  G4int crossing_budget;
+  G4PeriodicBudgetPolicy budget_policy;
+  G4double survival_probability;
+  G4PeriodicTrajectoryMode trajectory_mode;
+  G4bool wrapped_safety;
+  G4bool statistics;
+
+  //the /pbc/stats/ commands, created with the constructor on the master
+  G4PeriodicStatisticsMessenger* stats_messenger;
+
 };
@@ -1,28 +1,89 @@
 #pragma once
 
+#include "G4AffineTransform.hh"
 #include "G4Step.hh"
 #include "G4DynamicParticle.hh"
-#include "G4OpticalPhoton.hh"
-#include "G4AntiNeutrinoE.hh"
-#include "G4NeutrinoE.hh"
-#include "G4AntiNeutrinoMu.hh"
-#include "G4NeutrinoMu.hh"
-#include "G4AntiNeutrinoTau.hh"
-#include "G4NeutrinoTau.hh"
+#include "G4EventManager.hh"
+#include "G4LogicalVolumePeriodic.hh"
 #include "G4ParticleChangeForPeriodic.hh"
+#include "G4PeriodicCell.hh"
+#include "G4PeriodicStatistics.hh"
+#include "G4TouchableHistory.hh"
+#include "G4TrackingManager.hh"
 #include "G4TransportationManager.hh"
 #include "G4VDiscreteProcess.hh"
+#include "G4VTrajectory.hh"
 
 #include "globals.hh"
 
+#include <map>
+#include <set>
+#include <vector>
+
+class G4LogicalVolume;
+class G4NavigationHistory;
+class G4ParallelWorldProcess;
+class G4Navigator;
+class G4PropagatorInField;
+class G4Region;
+class G4VSolid;
+class G4VPhysicalVolume;
+
 enum G4PeriodicBoundaryProcessStatus {
   Undefined,
   Reflection,
   Cycling,
   StepTooSmall,
-  NotAtBoundary
+  NotAtBoundary,
+  LeftArray
  };
 
+/*the lattice vectors along which the cell repeats, combined as a bit mask*/
+enum G4PeriodicAxis {
+  fPeriodicX = 1,
+  fPeriodicY = 2,
+  fPeriodicZ = 4
+};
+
+/*selects when the stepping manager invokes PostStepDoIt. fDispatchEveryStep
+forces the process on every step of every particle; fDispatchPeriodicFace only
+forces it from volumes in which a step can end on a periodic face*/
+enum G4PeriodicDispatchMode {
+  fDispatchEveryStep,
+  fDispatchPeriodicFace
+};
+
+/*selects the particles to which the process is attached. particles added with
+ExcludeParticle are never attached, particles added with AddParticle are the
+only ones attached under fListedOnly*/
+enum G4PeriodicParticlePolicy {
+  fAllButNeutrinos,
+  fChargedOnly,
+  fNeutralOnly,
+  fListedOnly
+};
+
+/*what becomes of a track once it has crossed the periodic faces more times
+than its crossing budget. under fBudgetRoulette it is played Russian roulette,
+a survivor carrying the weight of those killed and being given a further
+budget; under fBudgetKill it is killed. a killed track deposits its kinetic
+energy where it is killed*/
+enum G4PeriodicBudgetPolicy {
+  fBudgetRoulette,
+  fBudgetKill
+};
+
+/*how a cycling is recorded in the trajectory of the track, when trajectories
+are stored. fTrajectoryAppend appends the point at which the particle left the
+cell, so that the trajectory is drawn up to the face. fTrajectoryCompact
+appends no point, and marks the image the track has moved into in its
+G4PeriodicImageInformation. fTrajectoryOff records nothing*/
+enum G4PeriodicTrajectoryMode {
+  fTrajectoryOff,
+  fTrajectoryAppend,
+  fTrajectoryCompact
+};
+
 class G4PeriodicBoundaryProcess : public G4VDiscreteProcess {
 
 public:
@@ -42,6 +103,17 @@ public:
 
   G4bool IsApplicable(const G4ParticleDefinition& );
 
+  void PreparePhysicsTable(const G4ParticleDefinition& );
+  void BuildPhysicsTable(const G4ParticleDefinition& );
+  // Caches the volumes from which the process must be forced. Called at the
+  // start of each run, once the geometry has been constructed.
+
+  G4double PostStepGetPhysicalInteractionLength(const G4Track& ,
+                                                G4double ,
+                                                G4ForceCondition* condition);
+  // Bypasses the interaction length bookkeeping of G4VDiscreteProcess, the
+  // process never limits the step.
+
   G4double GetMeanFreePath(const G4Track& ,
                            G4double ,
                            G4ForceCondition* condition);
@@ -53,57 +125,304 @@ public:
   G4PeriodicBoundaryProcessStatus GetStatus() const;
 
   G4VParticleChange* PostStepDoIt(const G4Track&, const G4Step&);
+  // Cycles or reflects the particle through every periodic face it leaves
+  // by, so that edges and corners are handled in a single invocation.
+
+  virtual G4VParticleChange* CrossPeriodicFace(const G4Track&, const G4Step&,
+    const G4VTouchable* entered);
+  // Applies the boundary condition to a step that transportation has found
+  // to leave a periodic volume, for G4PeriodicTransportation, given the
+  // touchable transportation has located the particle in. The particle
+  // change is only filled if the status is Cycling or Reflection.
+
+  G4bool IsPeriodicMother(const G4VPhysicalVolume* pv) const;
+  // True if the volume is the mother of a periodic volume, so that a step
+  // entering it may have crossed a periodic face.
+
+  G4int GetNumberOfPeriodicVolumes() const { return (G4int)periodic_volumes.size(); }
+
+  void StartTracking(G4Track* );
+  void EndTracking();
+  // Secondaries inherit the lattice image of their parent at the time they
+  // were created, see G4PeriodicImageInformation.
+
+  void RelocateParallelWorlds(const G4Track& track);
+  // Starts the parallel world processes of a track cycled in its last step
+  // tracking again where the track now is, which locates their navigators
+  // and resets their touchables and safety. Called at the start of the next
+  // step, once the stepping manager has moved the track.
+
+  void SetRecoveryDistance(G4double distance) { recovery_distance = distance; }
+  // Distance from the faces of the cell within which a crossing that is not
+  // on a face within the tolerance is put back on the nearest faces, rather
+  // than aborting the event. 1 micrometre by default. A charged track in a
+  // field is recovered within the delta intersection of its field manager
+  // if that is larger.
+
+  void SetCrossingBudget(G4int n) { crossing_budget = n; }
+  // Crossings a track may make before the budget policy applies to it,
+  // 0 (the default) for no limit.
+
+  void SetBudgetPolicy(G4PeriodicBudgetPolicy policy) { budget_policy = policy; }
+  void SetSurvivalProbability(G4double p) { survival_probability = p; }
+  // Probability of surviving each roulette, 0.5 by default.
+
+  void DumpBudgetStatistics() const;
+  // Prints the budget policy and the tracks it rouletted and killed in this
+  // thread since the statistics were reset.
+
+  const G4PeriodicStatistics& GetStatistics() const { return statistics; }
+  // The counters of this thread, see G4PeriodicStatisticsMessenger for those
+  // of all threads.
+
+  void SetTrajectoryMode(G4PeriodicTrajectoryMode mode) { trajectory_mode = mode; }
+  G4PeriodicTrajectoryMode GetTrajectoryMode() const { return trajectory_mode; }
+  // fTrajectoryAppend by default.
+
+  void SetDispatchMode(G4PeriodicDispatchMode mode) { dispatch_mode = mode; }
+  G4PeriodicDispatchMode GetDispatchMode() const { return dispatch_mode; }
+
+  void SetRegion(const G4String& name) { region_name = name; }
+  // Restricts the process to volumes of the named region; an empty name
+  // (the default) applies it everywhere.
+
+  void SetParticlePolicy(G4PeriodicParticlePolicy policy) { particle_policy = policy; }
+  void AddParticle(const G4String& name) { listed_particles.insert(name); }
+  void ExcludeParticle(const G4String& name) { excluded_particles.insert(name); }
+
+  /*the diagnostics compiled into the handling of a crossing. the generic
+  process compiles in both; without kStatistics only the aborted events, the
+  normal flips and the tracks leaving an array or their crossing budget are
+  counted, and the time is not measured*/
+  enum { kNoDiagnostics = 0, kStatistics = 1, kVerbose = 2 };
 
 protected:
 
+  template <G4int FaceMask, G4PeriodicBoundaryKind Kind, G4int Diagnostics>
+  G4VParticleChange* CrossBoundary(const G4Track&, const G4Step&);
+  // The body of PostStepDoIt, with the faces that may be periodic, the
+  // boundary condition and the verbose output fixed at compile time.
+
+  template <G4int FaceMask, G4PeriodicBoundaryKind Kind, G4int Diagnostics>
+  G4VParticleChange* CrossPeriodicFaces(const G4Track&, const G4Step&,
+    const G4VTouchable* entered);
+  // The body of CrossPeriodicFace.
+
+  template <G4int FaceMask, G4PeriodicBoundaryKind Kind, G4int Diagnostics>
+  G4VParticleChange* DispatchFaces(const G4Track&, const G4Step&, G4bool relocate);
+  // Crosses the faces of the current periodic volume with the compiled in
+  // faces and boundary condition if the volume uses those of the process,
+  // or with those it was given otherwise.
+
+  template <G4int FaceMask, G4PeriodicBoundaryKind Kind, G4int Diagnostics>
+  G4VParticleChange* CrossFaces(const G4Track&, const G4Step&, G4bool relocate);
+  // Cycles or reflects a particle known to be on a face of the current
+  // periodic volume. A reflected particle is relocated if relocate is set.
+
+  enum { kAllFaces = 0xFF };
+
+  G4PeriodicBoundaryProcessStatus theStatus;
   G4ParticleChangeForPeriodic fParticleChange;
 
+  //the counters of this thread, also updated by const lookups
+  mutable G4PeriodicStatistics statistics;
+
 private:
 
   void BoundaryProcessVerbose(void) const;
 
-  G4PeriodicBoundaryProcessStatus theStatus;
-  G4ThreeVector OldPosition;
-	G4ThreeVector NewPosition;
-  G4ThreeVector OldMomentum;
-	G4ThreeVector NewMomentum;
-  G4ThreeVector OldPolarization;
-	G4ThreeVector NewPolarization;
-	G4ThreeVector theGlobalNormal;
+  struct PeriodicVolume;
+
+  void CacheGeometry();
+  void FindPeriodicVolumes(G4NavigationHistory& history);
+  // Adds every periodic volume below the top of the history, with its
+  // configuration and cell.
+  void FlagVolumesAtFaces(const PeriodicVolume& periodic,
+    const G4VPhysicalVolume* pv, const G4AffineTransform& to_cell,
+    G4bool replicated);
+  G4bool InRegion(const G4VPhysicalVolume* pv) const;
+
+  PeriodicVolume* FindPeriodicVolume(const G4Step& step,
+    const G4VTouchable* entered);
+  // Returns the periodic volume a step entering the mother of one has left,
+  // from the pre step touchable, or NULL if it has left another volume.
+
+  G4ThreeVector GetNavigatorNormal(const G4ThreeVector& point,
+    const G4ThreeVector& momentum) const;
+
+  void IndexLandingVolumes(PeriodicVolume& periodic,
+    const G4NavigationHistory& history);
+  void ClearLandingVolumes(PeriodicVolume& periodic);
+  G4int LeavingFaces(G4int faces, const G4ThreeVector& momentum) const;
+  G4int GetNavigatorFace(const G4ThreeVector& point,
+    const G4ThreeVector& momentum) const;
+  G4ThreeVector OutwardNormal(G4int face) const;
+  G4ThreeVector CycleThrough(const G4ThreeVector& position, G4int face) const;
+  G4double GetRecoveryDistance(const G4Track& track) const;
+  // The recovery distance, widened to the accuracy of the boundary
+  // intersection for a charged track in a field.
+  void ApplyCrossingBudget(const G4Track& track);
+  // Counts a crossing of the track, and roulettes or kills it each time it
+  // uses up its crossing budget.
+  void CountImage(const G4Track& track, G4int face,
+    const G4ThreeVector& displacement);
+  void CountInterval(const G4Track& track);
+  void RecordTrajectory(const G4Track& track, const G4Step& step);
+  void PassImageToSecondaries(const G4TrackVector* secondaries);
+  const G4TouchableHandle* FindLandingVolume(G4int face,
+    const G4ThreeVector& position, const G4ThreeVector& direction) const;
+  // Returns the touchable of the volume containing a cycled position, from
+  // the daughters indexed at the landing face, or NULL if the navigator
+  // must relocate the point from the top of the geometry.
+
+  G4VPhysicalVolume* Relocate(G4int faces, const G4ThreeVector& position,
+    const G4ThreeVector& direction);
+  // Locates the cycled position once and hands the resulting touchable to
+  // the particle change. Returns the volume located, NULL outside the world.
+  void EnterOpticalInterface(const G4Step& step, G4int faces,
+    const G4ThreeVector& position, const G4ThreeVector& direction,
+    const G4VPhysicalVolume* located);
+  // Locates a cycled optical photon that has landed in another material than
+  // it left again, by stepping into the cell through the faces it landed on,
+  // so that G4OpBoundaryProcess finds the normal of the faces. Such a
+  // crossing costs a locate outside the cell, a step computation and a
+  // locate at the landing point on top of the relocation, as
+  // G4OpBoundaryProcess takes the normal from the tracking navigator only.
+
+  void ResolveArrays();
+  // Finds the volume of each defect of the virtual arrays.
+  G4int ArrayFaces(const G4Track& track, G4int faces) const;
+  // Returns the faces through which the track stays in the virtual array.
+  void MoveToTile(const G4Track& track, G4ThreeVector& position);
+  // Moves a cycled track into the volume holding its cell of the array.
+  G4VParticleChange* LeaveArray(const G4Track& track, const G4Step& step,
+    const G4ThreeVector& position, const G4ThreeVector& direction);
+  // Moves a track crossing the edge of the virtual array to its unwrapped
+  // position, outside the array, or kills it there if the array is set to.
+
+  /*each worker thread has its own instance of the process, and the state of
+  a crossing is kept on the stack. only the status of the last invocation, the
+  state of the current track and the geometry cached for the run are kept*/
   G4double kCarTolerance;
 
   G4bool reflecting_walls;
 
   bool periodic_x; bool periodic_y; bool periodic_z;
+  G4int periodic_mask;
 
-};
+  G4double recovery_distance;
 
-inline G4bool G4PeriodicBoundaryProcess::IsApplicable(const G4ParticleDefinition&
-  aParticleType)
-{
+  G4int crossing_budget;
+  G4int track_crossings;
+  G4PeriodicBudgetPolicy budget_policy;
+  G4double survival_probability;
+
+  //the crossings of the current track so far, the step number and track
+  //length at the last one
+  G4int last_crossing_step;
+  G4double last_crossing_length;
+
+  G4Track* current_track;
+  size_t inherited_secondaries;
+
+  //the trajectory of the current track, found once when it starts
+  G4PeriodicTrajectoryMode trajectory_mode;
+  G4VTrajectory* trajectory;
+
+  G4PeriodicDispatchMode dispatch_mode;
+  G4PeriodicParticlePolicy particle_policy;
+  std::set<G4String> listed_particles;
+  std::set<G4String> excluded_particles;
+
+  G4String region_name;
+  G4Region* region;
+
+  //the tracking navigator of this thread, and the propagator of charged
+  //tracks in a field
+  G4Navigator* navigator;
+  G4PropagatorInField* field_propagator;
 
-  bool applicable = true;
-
-  if( &aParticleType == G4OpticalPhoton::OpticalPhoton() )
-    applicable = true;
-  else if ( &aParticleType == G4AntiNeutrinoE::AntiNeutrinoE() )
-    applicable = false;
-  else if ( &aParticleType == G4NeutrinoE::NeutrinoE() )
-    applicable = false;
-  else if ( &aParticleType == G4AntiNeutrinoMu::AntiNeutrinoMu() )
-    applicable = false;
-  else if ( &aParticleType == G4NeutrinoMu::NeutrinoMu() )
-    applicable = false;
-  else if ( &aParticleType == G4AntiNeutrinoTau::AntiNeutrinoTau() )
-    applicable = false;
-  else if ( &aParticleType == G4NeutrinoTau::NeutrinoTau() )
-    applicable = false;
-
-   return applicable;
+  const G4ParticleDefinition* optical_photon;
 
+  //the parallel world processes of each particle, and whether those of the
+  //current track must be relocated at its next step
+  std::map<const G4ParticleDefinition*, std::vector<G4ParallelWorldProcess*> >
+    parallel_worlds;
+  G4bool parallel_relocation;
+
+  //flags of the volume flag table
+  enum { kForcedFrom = 1, kPeriodicMother = 2 };
+
+  //indexed by physical volume instance id. kForcedFrom is set if a step
+  //starting in the volume can end on a periodic face, kPeriodicMother if the
+  //volume is the mother of a periodic volume
+  std::vector<G4int> volume_flags;
+  G4bool geometry_cached;
+
+  G4VPhysicalVolume* world_pv;
+
+  //a daughter of a periodic volume lying at a face, with the touchable used
+  //to restart navigation inside it, and handed to the stepping manager when
+  //the particle lands in it
+  struct LandingVolume {
+    const G4VPhysicalVolume* pv;
+    G4AffineTransform cell_to_local;
+    G4TouchableHandle touchable;
+  };
+
+  enum { kFaces = 2 * G4PeriodicCell::kMaxFacePairs };
+
+  /*a periodic volume, with the axes and boundary condition it was given or
+  those of the process, and the cell describing it in the global frame. of the
+  periodic faces, those in the reflecting mask reflect and the others cycle,
+  reflecting is set when all of them reflect*/
+  struct PeriodicVolume {
+    const G4VPhysicalVolume* pv;
+    G4LogicalVolumePeriodic* lv;
+    G4AffineTransform to_world;
+    G4bool reflecting;
+    G4bool specialised;
+
+    G4PeriodicCell cell;
+    G4AffineTransform volume_to_cell;
+    G4bool has_cell;
+    G4int periodic_mask;
+    G4int reflecting_mask;
+
+    //indexed by the bit of the crossed face, the daughters at the opposite
+    //face on which the cycled particle lands
+    std::vector<LandingVolume> landing_volumes[kFaces];
+    G4bool full_relocation[kFaces];
+    G4TouchableHandle cell_touchable;
+
+    //the periodic volume tiling the virtual array the volume belongs to, -1
+    //if it is not tiled. the tiling volume holds the periodic volume of each
+    //defect cell
+    G4int array;
+    std::map<G4LogicalVolumePeriodic::CellIndex, G4int> defects;
+  };
+
+  std::vector<PeriodicVolume> periodic_volumes;
+
+  //indexed by physical volume instance id, the periodic volume a physical
+  //volume is, or -1
+  std::vector<G4int> periodic_index;
+
+  //the periodic volume of the crossing being handled
+  PeriodicVolume* current;
+
+};
+
+inline G4bool G4PeriodicBoundaryProcess::IsPeriodicMother(
+  const G4VPhysicalVolume* pv) const
+{
+  size_t id = pv->GetInstanceID();
+  return (id < volume_flags.size() && (volume_flags[id] & kPeriodicMother));
 }
 
 inline G4PeriodicBoundaryProcessStatus G4PeriodicBoundaryProcess::GetStatus() const
 {
    return theStatus;
 }
+
+#include "G4PeriodicBoundaryProcess.icc"
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "G4AffineTransform.hh"
+#include "G4RotationMatrix.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+class G4VSolid;
+
+/*faces of the periodic cell, combined as a bit mask when a point lies on an
+edge or a corner. faces come in pairs; for a box or a triclinic cell the pairs
+are those of the x, y and z lattice vectors. a hexagonal cell uses the x, y and
+w pairs for its three pairs of sides and the z pair for its ends. a wedge has a
+single pair, the x pair, for the planes bounding it in phi*/
+enum G4PeriodicFace {
+  fNoFace = 0,
+  fFaceMinusX = 1,
+  fFacePlusX = 2,
+  fFaceMinusY = 4,
+  fFacePlusY = 8,
+  fFaceMinusZ = 16,
+  fFacePlusZ = 32,
+  fFaceMinusW = 64,
+  fFacePlusW = 128
+};
+
+/*the condition applied at a periodic face, the particle is either moved to the
+opposite face or reflected back into the cell. an open face is not periodic,
+the particle leaves the cell through it*/
+enum G4PeriodicBoundaryKind {
+  fCyclicBoundary,
+  fReflectingBoundary,
+  fOpenBoundary
+};
+
+enum G4PeriodicCellShape {
+  fBoxCell,
+  fTriclinicCell,
+  fHexagonalCell,
+  fWedgeCell
+};
+
+/*a periodic cell, described by three lattice vectors and its placement in the
+world, that identifies the faces a point lies on analytically and translates a
+point through a face onto the opposite face. the origin of the cell frame is
+the centre of the cell
+
+a wedge is periodic under rotation instead. it is the sector of a cylindrically
+symmetric solid between two planes through the z axis, and a point crossing
+one plane is rotated about the axis onto the other, as are the direction and
+polarization of the particle. the origin of its cell frame is on the axis and
+the x axis bisects the wedge*/
+
+class G4PeriodicCell
+{
+
+public:
+  static const G4int kMaxFacePairs = 4;
+
+  G4PeriodicCell();
+
+  G4PeriodicCell(const G4ThreeVector& half_length,
+    const G4AffineTransform& cell_to_world, G4double tolerance);
+  // An axis-aligned box.
+
+  G4PeriodicCell(const G4ThreeVector& a, const G4ThreeVector& b,
+    const G4ThreeVector& c, const G4AffineTransform& cell_to_world,
+    G4double tolerance);
+  // A parallelepiped spanned by three lattice vectors, given in the cell
+  // frame.
+
+  G4PeriodicCell(G4double apothem, G4double half_z, G4double phi_start,
+    const G4AffineTransform& cell_to_world, G4double tolerance);
+  // A hexagonal prism along z with sides at the given distance from the
+  // axis, as placed by a six sided G4Polyhedra starting at phi_start.
+
+  G4PeriodicCell(G4double half_angle, const G4AffineTransform& cell_to_world,
+    G4double tolerance);
+  // A wedge about the z axis, from -half_angle to half_angle in phi.
+
+  ~G4PeriodicCell();
+
+  G4bool Build(const G4VSolid* solid, const G4AffineTransform& to_world,
+    G4double tolerance, G4AffineTransform& volume_to_cell);
+  // Describes a box, parallelepiped, hexagonal prism, or a G4Tubs or
+  // G4Polycone open in phi, placed in the world as a periodic cell, returns
+  // false for any other solid. volume_to_cell is set to the transform from
+  // the frame of the solid to the cell frame.
+
+  G4int LocateFaces(const G4ThreeVector& global_point) const;
+  // Returns the mask of faces on which the point lies, fNoFace if it is
+  // further than the tolerance from every face.
+
+  G4bool OnOpenSurface(const G4ThreeVector& global_point) const;
+  // Returns true if the point is on a surface of the cell that is not a
+  // face, as the inner and outer radius and the ends of a wedge. The point
+  // is assumed not to be on any face.
+
+  G4int LeavingFaces(G4int faces, const G4ThreeVector& global_direction) const;
+  // Returns the faces of the mask through which the direction points out.
+
+  G4int RecoverFaces(const G4ThreeVector& global_point,
+    const G4ThreeVector& global_direction, G4double recovery,
+    G4ThreeVector& on_faces) const;
+  // Returns the faces within the recovery distance of a point that is not
+  // on any face within the tolerance, preferring those the direction leaves
+  // through, and sets on_faces to the point projected onto them. fNoFace if
+  // the point is further than the recovery distance from every face.
+
+  G4int FacesReached(const G4ThreeVector& pmin, const G4ThreeVector& pmax) const;
+  // Returns the faces reached by a box given by its limits in the cell frame.
+
+  G4ThreeVector GetOutwardNormal(G4int face) const;
+  // Returns the outward normal of a single face in the global frame.
+
+  G4ThreeVector CycleThrough(const G4ThreeVector& global_point, G4int face) const;
+  // Returns the image of a point on a single face on the opposite face.
+
+  G4ThreeVector RotateThrough(const G4ThreeVector& global_vector, G4int face) const;
+  // Returns a direction or polarization carried through a single face, the
+  // vector itself unless the cell is rotational.
+
+  G4RotationMatrix GetFaceRotation(G4int face) const;
+  // Returns the rotation applied through a single face in the global frame.
+
+  G4ThreeVector Wrap(const G4ThreeVector& global_point,
+    const G4ThreeVector* global_direction, G4int mask,
+    G4ThreeVector& displacement) const;
+  // Returns the image inside the cell of a point at any distance from it,
+  // translating only through the faces of the mask. A point on a face and
+  // leaving it along the direction is moved to the opposite face.
+  // displacement is the translation applied, zero if the point is inside.
+
+  G4double DistanceToFaces(const G4ThreeVector& global_point,
+    const G4ThreeVector& global_direction, G4int mask, G4int& faces) const;
+  // Returns the distance along the direction to the planes of the faces of
+  // the mask ahead of the point, and the faces reached at that distance.
+
+  G4double SafetyToFace(const G4ThreeVector& global_point, G4int face) const;
+  // Returns the distance of a point from the plane of a single face,
+  // negative beyond it.
+
+  G4int GetPeriodicMask(G4bool per_a, G4bool per_b, G4bool per_c) const;
+  // Returns the faces that are periodic when the cell repeats along the
+  // chosen lattice vectors. a pair is periodic if every lattice vector of
+  // the translation between its faces is.
+
+  const G4int* GetImageShift(G4int face) const;
+  // Returns the change of image along each lattice vector when a particle
+  // crosses a single face.
+
+  static G4int CountFaces(G4int mask);
+  static G4int GetPair(G4int face);
+  static G4bool IsPlusFace(G4int face);
+  static G4int GetOppositeFace(G4int face);
+
+  G4PeriodicCellShape GetShape() const { return shape; }
+  G4bool IsRotational() const { return shape == fWedgeCell; }
+  G4double GetHalfAngle() const { return half_angle; }
+  G4int GetNumberOfFacePairs() const { return npairs; }
+  const G4ThreeVector& GetLatticeVector(G4int i) const { return lattice[i]; }
+  const G4AffineTransform& GetWorldToCell() const { return world_to_cell; }
+  const G4AffineTransform& GetCellToWorld() const { return cell_to_world; }
+
+private:
+
+  void AddFacePair(G4int pair, const G4ThreeVector& normal, G4int shift_a,
+    G4int shift_b, G4int shift_c);
+
+  G4ThreeVector WedgeNormal(G4int face) const;
+  G4ThreeVector WedgeDirection(G4int face) const;
+  // The outward normal of a face of a wedge, and the direction from the
+  // axis along it, in the cell frame.
+  G4int LocateWedgeFaces(const G4ThreeVector& local) const;
+
+  //a pair of opposite faces, at distance from the centre along the normal of
+  //the plus face. crossing the plus face moves the point by minus the
+  //translation, into the neighbouring image given by the shift
+  struct FacePair {
+    G4ThreeVector normal;
+    G4double distance;
+    G4ThreeVector translation;
+    G4int shift[3];
+  };
+
+  G4PeriodicCellShape shape;
+  G4ThreeVector lattice[3];
+  FacePair pairs[kMaxFacePairs];
+  G4int npairs;
+  G4int pair_mask;
+  G4double half_angle;
+
+  G4AffineTransform cell_to_world;
+  G4AffineTransform world_to_cell;
+  G4double tolerance;
+
+  //the solid of a wedge, whose other surfaces are left to transportation
+  const G4VSolid* wedge_solid;
+  G4AffineTransform world_to_solid;
+};
+
+inline G4int G4PeriodicCell::LocateFaces(const G4ThreeVector& global_point) const
+{
+  G4ThreeVector local = world_to_cell.TransformPoint(global_point);
+
+  if (shape == fWedgeCell) return LocateWedgeFaces(local);
+
+  G4int mask = fNoFace;
+
+  for (G4int i = 0; i < kMaxFacePairs; ++i) {
+    if (!(pair_mask & (1 << i))) continue;
+    G4double height = pairs[i].normal * local;
+    if (std::fabs(height - pairs[i].distance) <= tolerance)
+      mask |= (fFacePlusX << (2*i));
+    else if (std::fabs(height + pairs[i].distance) <= tolerance)
+      mask |= (fFaceMinusX << (2*i));
+  }
+
+  return mask;
+}
+
+inline G4int G4PeriodicCell::CountFaces(G4int mask)
+{
+  G4int count = 0;
+  for (; mask; mask &= mask - 1) ++count;
+  return count;
+}
+
+inline G4int G4PeriodicCell::GetPair(G4int face)
+{
+  G4int bit = 0;
+  while (bit < 2*kMaxFacePairs - 1 && !(face & (1 << bit))) ++bit;
+  return bit / 2;
+}
+
+inline G4bool G4PeriodicCell::IsPlusFace(G4int face)
+{
+  return face & (fFacePlusX | fFacePlusY | fFacePlusZ | fFacePlusW);
+}
+
+inline G4int G4PeriodicCell::GetOppositeFace(G4int face)
+{
+  return IsPlusFace(face) ? (face >> 1) : (face << 1);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "G4PeriodicCell.hh"
+#include "G4VFastSimulationModel.hh"
+#include "globals.hh"
+
+class G4LogicalVolume;
+class G4Region;
+class G4VPhysicalVolume;
+
+/*a fast simulation model, on the envelope of the periodic world volume, that
+moves a neutral particle along its straight line through as many images of
+the cell as it crosses before its next interaction, in a single step. the
+model is triggered when the particle is in the periodic world volume itself
+and its line reaches the periodic faces a minimum number of times before any
+daughter or non periodic face
+
+the distance to the next interaction is the one the physics processes of the
+particle already hold, as they would give it to the stepping manager. the
+particle is left on the periodic face it last entered by, and the processes
+take the fast step off their interaction lengths at the next step, so that the
+interactions happen where they would without the model. processes without an
+interaction length, such as a step limiter, do not limit a fast step. the
+fast simulation process must be asked for the step before the physics
+processes, as G4FastSimulationPhysics orders it, and the model is only
+triggered on the second step of a track in the volume. the lattice image of
+the track is updated as the periodic boundary process does
+
+the envelope is the region returned by G4PeriodicBoundaryBuilder::
+ConstructEnvelope, and the particles must be activated for fast simulation,
+for instance with G4FastSimulationPhysics*/
+
+class G4PeriodicFastForwardModel : public G4VFastSimulationModel
+{
+
+public:
+  G4PeriodicFastForwardModel(const G4String& name, G4Region* envelope,
+    G4bool per_x = true, G4bool per_y = true, G4bool per_z = false);
+  virtual ~G4PeriodicFastForwardModel();
+
+  virtual G4bool IsApplicable(const G4ParticleDefinition& particle);
+  // Neutral particles other than optical photons.
+
+  virtual G4bool ModelTrigger(const G4FastTrack& fast_track);
+  virtual void DoIt(const G4FastTrack& fast_track, G4FastStep& fast_step);
+
+  void SetMinimumCrossings(G4int n) { minimum_crossings = n; }
+  // Crossings the line of the particle must be able to make before the
+  // model is triggered, 2 by default.
+
+  void SetMaximumCrossings(G4int n) { maximum_crossings = n; }
+  // Crossings made in a single fast step at most.
+
+  G4long GetNumberOfCrossings() const { return number_of_crossings; }
+  G4long GetNumberOfFastSteps() const { return number_of_fast_steps; }
+
+private:
+
+  void CacheCell(const G4FastTrack& fast_track);
+
+  G4int Advance(G4ThreeVector& point, const G4ThreeVector& direction,
+    G4double limit, G4int max_crossings, G4double& travelled,
+    const G4Track* track);
+  // Moves the point along the direction through the periodic faces it
+  // reaches within limit, as long as the line stays clear of the daughters
+  // and of the faces that are not periodic. Returns the number of crossings,
+  // and counts the lattice images of the track if one is given.
+
+  G4double DistanceToDaughters(const G4ThreeVector& point,
+    const G4ThreeVector& direction, G4double limit) const;
+
+  G4double InteractionDistance(const G4Track& track,
+    G4double previous_step) const;
+  // Returns the distance to the next interaction held by the processes of
+  // the particle, once they have taken off its previous step.
+
+  G4bool periodic_x, periodic_y, periodic_z;
+
+  G4int minimum_crossings;
+  G4int maximum_crossings;
+
+  //the periodic world volume the cell was built for, with its transform from
+  //the global frame
+  const G4VPhysicalVolume* envelope_pv;
+  G4AffineTransform to_envelope;
+  G4PeriodicCell cell;
+  G4bool has_cell;
+  G4int periodic_mask;
+  G4double tolerance;
+
+  //the track, step and track length of the last trigger, and the length of
+  //the step before the current one, which the processes have yet to take off
+  const G4Track* last_track;
+  G4int last_track_id;
+  G4int last_step_number;
+  G4double last_track_length;
+  G4double previous_step;
+
+  //a track the model has declined at a point is not triggered again there
+  const G4Track* declined_track;
+  G4ThreeVector declined_position;
+
+  G4long number_of_crossings;
+  G4long number_of_fast_steps;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "G4RotationMatrix.hh"
+#include "G4ThreeVector.hh"
+#include "G4VUserTrackInformation.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class G4Track;
+
+/*the lattice image a track has reached by cycling through the periodic world
+volume, attached to the track as auxiliary information by the periodic boundary
+process. the image is counted along each lattice vector of the cell, and the
+offset is the displacement that maps a wrapped position back to the unfolded
+space, so that the unwrapped position is found without a per step lookup.
+tracks that have never cycled carry no information and are in image zero
+
+the information is the user information of the track. any user information the
+track already held is kept inside it, and is returned and replaced through
+GetUserInformation and SetUserInformation below. user code that sets its own
+information directly on a track that has cycled replaces the image, which is
+then lost but never misread
+
+a track that has cycled through a rotational cell, a wedge, is also turned.
+its unwrapped position is then the rotation applied to the wrapped position,
+plus the offset, and its unwrapped direction the rotation applied to its
+direction
+
+when the trajectories are recorded compactly, see G4PeriodicTrajectoryMode,
+each cycling is marked with the index of the first trajectory point in the new
+image and the offset of that image. the markers are not passed to secondaries,
+and are only available until the end of the tracking of the track*/
+
+class G4PeriodicImageInformation : public G4VUserTrackInformation
+{
+
+public:
+  G4PeriodicImageInformation(G4VUserTrackInformation* user_information = NULL);
+  G4PeriodicImageInformation(const G4PeriodicImageInformation& right);
+  // Copies the image and offset, not the user information, for a secondary.
+  virtual ~G4PeriodicImageInformation();
+  // Deletes the user information held, as the track would have.
+
+  virtual void Print() const;
+
+  void AddCrossing(const G4int* shift, G4int sign,
+    const G4ThreeVector& displacement);
+  // Moves the track into the neighbouring image given by the lattice shift
+  // of the crossed face, displaced by the translation applied to it.
+
+  void AddCrossing(const G4int* shift, G4int sign, const G4RotationMatrix& turn,
+    const G4ThreeVector& translation);
+  // As above for a crossing that has turned the track, after which the
+  // position before the crossing is turn * position + translation.
+
+  void AddOffset(const G4ThreeVector& displacement);
+  // Accounts for a move of the track between two volumes holding the same
+  // image, such as the cells of a virtual array.
+
+  void Reset();
+  // Returns the track to image zero, once its position is unwrapped.
+
+  G4int GetImage(G4int i) const { return image[i]; }
+  const G4ThreeVector& GetOffset() const { return offset; }
+  const G4RotationMatrix& GetRotation() const { return rotation; }
+
+  struct WrapMarker {
+    G4int point;
+    G4ThreeVector offset;
+    G4RotationMatrix rotation;
+  };
+
+  void AddWrapMarker(G4int point);
+  // Marks the trajectory point from which the track is in its current image.
+
+  const std::vector<WrapMarker>& GetWrapMarkers() const { return wrap_markers; }
+
+  G4ThreeVector GetPointOffset(G4int point) const;
+  // Returns the offset of the image a trajectory point of a compactly
+  // recorded trajectory is in, to be added to its position to unwrap it.
+  G4ThreeVector UnwrapPoint(G4int point, const G4ThreeVector& position) const;
+  // Unwraps the position of a trajectory point, turned as well as offset.
+
+  static G4PeriodicImageInformation* Get(const G4Track* track);
+  // Returns the image information of a track, NULL in image zero.
+
+  static G4PeriodicImageInformation* Attach(const G4Track* track);
+  // Returns the image information of a track, attaching it in image zero
+  // around any user information of the track if it has none.
+
+  static void Attach(const G4Track* track,
+    const G4PeriodicImageInformation& parent);
+  // Attaches to a secondary the image of its parent.
+
+  static G4VUserTrackInformation* GetUserInformation(const G4Track* track);
+  static void SetUserInformation(const G4Track* track,
+    G4VUserTrackInformation* user_information);
+  // Returns and replaces the user information of a track, held inside its
+  // image information if it has any. As with G4Track, the information
+  // replaced is not deleted.
+
+  static G4ThreeVector GetUnwrappedPosition(const G4Track* track);
+  static G4ThreeVector Unwrap(const G4Track* track, const G4ThreeVector& point);
+  // Returns the position of the track (or a point in its current image) in
+  // the unfolded space.
+
+  static G4ThreeVector UnwrapDirection(const G4Track* track,
+    const G4ThreeVector& direction);
+  // Returns a direction or polarization of the track in the unfolded space.
+
+private:
+  const WrapMarker* FindMarker(G4int point) const;
+
+  G4int image[3];
+  G4ThreeVector offset;
+  G4RotationMatrix rotation;
+  std::vector<WrapMarker> wrap_markers;
+
+  G4VUserTrackInformation* user_information;
+};
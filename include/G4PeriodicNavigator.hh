@@ -0,0 +1,122 @@
+#pragma once
+
+#include "G4AffineTransform.hh"
+#include "G4Navigator.hh"
+#include "G4PeriodicCell.hh"
+#include "globals.hh"
+
+class G4VPhysicalVolume;
+
+/*a tracking navigator that moves particles through the unfolded, infinitely
+repeated lattice of the periodic world volume. positions handed to and returned
+by the navigator are in the unfolded space; each is mapped into the cell before
+the geometry is searched, and the translation between the two is kept. a step
+reaching a periodic face is continued through the opposite face without being
+limited, as long as the particle stays in the same volume, so that in a
+homogeneous or sparse cell only physics or a real change of volume ends a step
+
+touchables and the transforms of the navigation history remain those of the
+cell. a position is returned to the cell with Wrap. the navigator is installed
+for tracking by G4PeriodicBoundaryPhysics in the fPeriodicNavigator mode
+
+the safety may be wrapped as well. G4Navigator takes the faces of the cell for
+boundaries, so that multiple scattering shrinks its steps near every face
+although the material goes on beyond it. a wrapped safety limited by the
+periodic faces is found instead from the daughters of the cell and of its
+images across the faces within reach, bounded by the other faces and by the
+far faces of the neighbouring images. a displacement within it may leave the
+cell, which is harmless here as every position is unfolded, but would not be
+in the other modes*/
+
+class G4PeriodicNavigator : public G4Navigator
+{
+
+public:
+  G4PeriodicNavigator(G4bool per_x = true, G4bool per_y = true,
+    G4bool per_z = false);
+  virtual ~G4PeriodicNavigator();
+
+  virtual G4double ComputeStep(const G4ThreeVector& point,
+    const G4ThreeVector& direction, const G4double proposed_step,
+    G4double& new_safety);
+  // Returns the length of the step through the unfolded lattice, crossing
+  // as many periodic faces as the proposed step allows.
+
+  virtual G4VPhysicalVolume* LocateGlobalPointAndSetup(
+    const G4ThreeVector& point, const G4ThreeVector* direction = 0,
+    const G4bool pRelativeSearch = true, const G4bool ignoreDirection = true);
+
+  virtual G4VPhysicalVolume* ResetHierarchyAndLocate(const G4ThreeVector& point,
+    const G4ThreeVector& direction, const G4TouchableHistory& h);
+
+  virtual void LocateGlobalPointWithinVolume(const G4ThreeVector& position);
+
+  virtual G4double ComputeSafety(const G4ThreeVector& point,
+    const G4double max_length = DBL_MAX, const G4bool keep_state = true);
+
+  void SetWrappedSafety(G4bool wrap) { wrapped_safety = wrap; }
+  // Extends the safety of a point in the cell itself across its periodic
+  // faces, off by default.
+
+  G4ThreeVector Wrap(const G4ThreeVector& point) const;
+  // Returns the image of an unfolded position inside the cell.
+
+  const G4ThreeVector& GetImageOffset() const { return offset; }
+  // The translation from the cell to the image of the located point.
+
+  G4long GetNumberOfCrossings() const { return number_of_crossings; }
+  // Periodic faces crossed within steps since the navigator was built.
+
+private:
+
+  void CacheCell();
+  // Finds the periodic world volume in the world and describes it as a
+  // periodic cell. Called whenever the world volume changes.
+
+  G4bool IsSeamless(const G4ThreeVector& landing,
+    const G4ThreeVector& direction);
+  // True if the point landed on across a periodic face lies in the volume in
+  // which the step is being computed.
+
+  G4double WrapSafety(const G4ThreeVector& local, G4double safety,
+    G4double max_length) const;
+  // Returns the safety of a located point in the cell frame, given the one
+  // found by G4Navigator, extended across the periodic faces.
+
+  G4double DaughterSafety(const G4ThreeVector& local) const;
+  // Returns the distance of a point in the cell frame to the daughters of
+  // the periodic volume.
+
+  G4bool periodic_x, periodic_y, periodic_z;
+
+  const G4VPhysicalVolume* cell_world;
+  G4PeriodicCell cell;
+  G4bool has_cell;
+  G4int periodic_mask;
+  G4double tolerance;
+
+  //the periodic volume, and the transform from the cell frame to its own.
+  //its safety is only wrapped if none of its daughters is replicated
+  const G4VPhysicalVolume* cell_pv;
+  G4AffineTransform world_to_volume;
+  G4bool wrapped_safety;
+  G4bool can_wrap;
+
+  //the translation of the located point, and that of the end of the last
+  //computed step, which becomes the former once the end point is located.
+  //both belong to the track being navigated, and are found again from the
+  //position when a track is located from the top
+  G4ThreeVector offset;
+  G4ThreeVector step_offset;
+
+  //the volume of the located point, and a second navigator on the same world
+  //that finds the volume landed in without disturbing the state of this one
+  G4VPhysicalVolume* current_pv;
+  G4Navigator* probe;
+
+  //set while G4Navigator calls back into the overridden methods with points
+  //that are already in the cell
+  G4bool in_cell_frame;
+
+  G4long number_of_crossings;
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "G4PeriodicCell.hh"
+#include "globals.hh"
+
+#include <chrono>
+#include <iosfwd>
+
+/*counters of what the periodic boundary process does, kept by the process of
+each thread and counted without locking. the counters of all threads are found
+through a registry, which is only locked when a process is built or deleted
+and when the counters are merged or reset. merging reads the counters of the
+workers, so it is done once they have ended their run, as it is by the master
+at the end of each run, see G4PeriodicStatisticsMessenger. in a multithreaded
+run the process of the master tracks nothing, and its counters are left out
+
+the steps and the track length between two crossings of a track are
+histogrammed in powers of two. bin 0 holds fewer than one step, or less than a
+micrometre, and bin i the range from 2^(i-1) to 2^i; the last bin holds all
+beyond. the time spent in the process is only measured if timing is enabled*/
+
+class G4PeriodicStatistics
+{
+
+public:
+  enum { kFaces = 2 * G4PeriodicCell::kMaxFacePairs, kBins = 32 };
+
+  G4PeriodicStatistics();
+  ~G4PeriodicStatistics();
+
+  void CountInvocation() { invocations++; }
+  void CountCrossing(G4int face);
+  // Counts a cycle through a single face, given by its bit.
+  void CountReflection() { reflections++; }
+  void CountStepTooSmall() { steps_too_small++; }
+  // Counts a crossing by a step too small to leave the surface.
+  void CountNormalFlip() { normal_flips++; }
+  void CountRecovery() { recoveries++; }
+  void CountAbortedEvent() { aborted_events++; }
+  void CountRoulette() { roulettes++; }
+  void CountBudgetKill(G4double energy) { budget_kills++; budget_energy += energy; }
+  void CountArrayExit() { array_exits++; }
+  void CountArrayKill(G4double energy) { array_kills++; array_energy += energy; }
+
+  void AddInterval(G4int steps, G4double length);
+  // Histograms the steps and the track length since the previous crossing.
+
+  void AddTime(G4double seconds) { time += seconds; timed_invocations++; }
+
+  void Add(const G4PeriodicStatistics& other);
+  void Reset();
+
+  void Print(std::ostream& os) const;
+  void Write(std::ostream& os) const;
+  // Writes the counters as a JSON object.
+
+  G4long GetInvocations() const { return invocations; }
+  G4long GetCrossings(G4int face) const;
+  G4long GetPairCrossings(G4int pair) const;
+  G4long GetReflections() const { return reflections; }
+  G4long GetStepsTooSmall() const { return steps_too_small; }
+  G4long GetNormalFlips() const { return normal_flips; }
+  G4long GetRecoveries() const { return recoveries; }
+  G4long GetAbortedEvents() const { return aborted_events; }
+  G4long GetRoulettes() const { return roulettes; }
+  G4long GetBudgetKills() const { return budget_kills; }
+  G4double GetBudgetEnergy() const { return budget_energy; }
+  G4long GetArrayExits() const { return array_exits; }
+  G4long GetArrayKills() const { return array_kills; }
+  G4double GetArrayEnergy() const { return array_energy; }
+  G4double GetTime() const { return time; }
+
+  static void Merge(G4PeriodicStatistics& total);
+  // Adds the counters of every thread to total, but those of the master in
+  // a multithreaded application.
+  static void ResetAll();
+
+  static void SetTiming(G4bool timing) { timing_enabled = timing; }
+  static G4bool IsTiming() { return timing_enabled; }
+
+  /*measures the time from its construction to the end of its scope, if
+  timing is enabled and the timer is, as it is unless compiled out*/
+  class Timer
+  {
+  public:
+    Timer(G4PeriodicStatistics& statistics, G4bool enabled = true) :
+      stats(statistics)
+    {
+      timed = enabled && timing_enabled;
+      if (timed) start = std::chrono::steady_clock::now();
+    }
+    ~Timer()
+    {
+      if (!timed) return;
+      std::chrono::duration<G4double> elapsed =
+        std::chrono::steady_clock::now() - start;
+      stats.AddTime(elapsed.count());
+    }
+  private:
+    G4PeriodicStatistics& stats;
+    G4bool timed;
+    std::chrono::steady_clock::time_point start;
+  };
+
+private:
+
+  G4PeriodicStatistics(const G4PeriodicStatistics &right);
+  G4PeriodicStatistics& operator=(const G4PeriodicStatistics &right);
+
+  static G4int Bin(G4double value);
+
+  G4long invocations;
+  G4long crossings[kFaces];
+  G4long reflections;
+  G4long steps_too_small;
+  G4long normal_flips;
+  G4long recoveries;
+  G4long aborted_events;
+  G4long roulettes;
+  G4long budget_kills;
+  G4double budget_energy;
+  G4long array_exits;
+  G4long array_kills;
+  G4double array_energy;
+
+  G4long step_histogram[kBins];
+  G4long length_histogram[kBins];
+
+  G4long timed_invocations;
+  G4double time;
+
+  G4bool master;
+
+  static G4bool timing_enabled;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "G4UImessenger.hh"
+#include "G4VStateDependent.hh"
+#include "globals.hh"
+
+class G4UIcmdWithABool;
+class G4UIcmdWithAString;
+class G4UIcmdWithoutParameter;
+class G4UIdirectory;
+class G4PeriodicStatistics;
+
+/*the /pbc/stats/ commands, which print, dump and reset the statistics of the
+periodic boundary process merged over all threads. the commands are executed
+by the master only, and are meant to be issued between runs
+
+  /pbc/stats/print                  - prints the merged statistics
+  /pbc/stats/dump <file>            - writes them to a file as JSON
+  /pbc/stats/reset                  - resets the statistics of every thread
+  /pbc/stats/timing <bool>          - measures the time spent in the process
+  /pbc/stats/printAtEndOfRun <bool> - prints them at the end of each run
+  /pbc/stats/dumpAtEndOfRun <file>  - writes them at the end of each run,
+                                      none if the file is empty
+
+the messenger is created on the master, and is told by its state manager when
+a run ends. the master only returns to idle once the workers have ended their
+run, so the counters of every thread are complete. they are printed at the end
+of each run unless switched off, and are not reset between runs*/
+
+class G4PeriodicStatisticsMessenger : public G4UImessenger,
+  public G4VStateDependent
+{
+
+public:
+  G4PeriodicStatisticsMessenger();
+  virtual ~G4PeriodicStatisticsMessenger();
+
+  virtual void SetNewValue(G4UIcommand* command, G4String value);
+
+  virtual G4bool Notify(G4ApplicationState requested_state);
+  // Reports the merged statistics when the master returns to idle after a
+  // run.
+
+private:
+  void Dump(const G4String& file_name, const G4PeriodicStatistics& total) const;
+
+  G4bool print_at_end;
+  G4String dump_at_end;
+
+  G4UIdirectory* pbc_directory;
+  G4UIdirectory* stats_directory;
+  G4UIcmdWithoutParameter* print_command;
+  G4UIcmdWithAString* dump_command;
+  G4UIcmdWithoutParameter* reset_command;
+  G4UIcmdWithABool* timing_command;
+  G4UIcmdWithABool* print_at_end_command;
+  G4UIcmdWithAString* dump_at_end_command;
+};
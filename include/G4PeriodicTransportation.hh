@@ -0,0 +1,63 @@
+#pragma once
+
+#include "G4Transportation.hh"
+#include "globals.hh"
+
+class G4PeriodicBoundaryProcess;
+
+/*transportation that applies the periodic boundary condition itself. when a
+step ends by entering the mother of the periodic world volume, the crossing is
+handed to a periodic boundary process within the post step action of
+transportation, and the particle change of the boundary process, holding the
+wrapped position and the touchable of the volume it lands in, is returned in
+place of that of transportation. no separate process is then added to the
+process vector of each particle, and no process is forced on any step
+
+the boundary process is only invoked through the transportation and need not be
+registered with any process manager. like every process it is deleted with the
+process table
+
+transportation keeps the touchable it located at the end of each step, and
+reuses it when its next step ends in the same volume. the touchable of the
+wrapped particle is put in its place, which needs the data members of
+G4Transportation that Geant4 11 makes protected. G4PeriodicBoundaryPhysics
+only uses this mode from Geant4 11*/
+
+class G4PeriodicTransportation : public G4Transportation {
+
+public:
+
+  G4PeriodicTransportation(G4PeriodicBoundaryProcess* boundary,
+    G4int verbosity = 0);
+  virtual ~G4PeriodicTransportation();
+
+private:
+
+  G4PeriodicTransportation(const G4PeriodicTransportation &right);
+
+  G4PeriodicTransportation& operator=(const G4PeriodicTransportation &right);
+
+public:
+
+  void PreparePhysicsTable(const G4ParticleDefinition& );
+  void BuildPhysicsTable(const G4ParticleDefinition& );
+
+  G4double PostStepGetPhysicalInteractionLength(const G4Track& track,
+    G4double previousStepSize, G4ForceCondition* pForceCond);
+  // Relocates the parallel world processes of a track cycled in its last
+  // step, see G4PeriodicBoundaryProcess::RelocateParallelWorlds.
+
+  G4VParticleChange* PostStepDoIt(const G4Track&, const G4Step&);
+  // Relocates the particle as G4Transportation does, then cycles or reflects
+  // it if the step has left the periodic world volume.
+
+  void StartTracking(G4Track* );
+  void EndTracking();
+
+  G4PeriodicBoundaryProcess* GetBoundaryProcess() const { return boundary; }
+
+private:
+
+  G4PeriodicBoundaryProcess* boundary;
+
+};
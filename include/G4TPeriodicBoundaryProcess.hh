@@ -0,0 +1,56 @@
+#pragma once
+
+#include "G4PeriodicBoundaryProcess.hh"
+
+/*a periodic boundary process with the periodic lattice vectors, the boundary
+condition and the diagnostic level fixed at compile time. faces that cannot be
+periodic are never cycled or reflected, and only those that can are visited.
+below kVerbose the verbose output is compiled out whatever the verbose level,
+and below kStatistics the counters of each crossing and the timer are too.
+periodic volumes given their own axes or boundary condition are handled at run
+time. G4PeriodicBoundaryPhysics chooses the instantiation from its arguments;
+the generic G4PeriodicBoundaryProcess remains available for configurations
+decided at run time
+
+  AxisMask    - combination of fPeriodicX, fPeriodicY and fPeriodicZ
+  Kind        - fCyclicBoundary or fReflectingBoundary
+  Diagnostics - kNoDiagnostics, kStatistics or kVerbose, which includes the
+                statistics*/
+
+template <G4int AxisMask, G4PeriodicBoundaryKind Kind,
+  G4int Diagnostics = G4PeriodicBoundaryProcess::kStatistics>
+class G4TPeriodicBoundaryProcess : public G4PeriodicBoundaryProcess {
+
+public:
+
+  G4TPeriodicBoundaryProcess(const G4String& processName = "CycBoundary",
+    G4ProcessType type = fNotDefined) :
+    G4PeriodicBoundaryProcess(processName, type, (AxisMask & fPeriodicX) != 0,
+      (AxisMask & fPeriodicY) != 0, (AxisMask & fPeriodicZ) != 0,
+      Kind == fReflectingBoundary) {}
+
+  virtual ~G4TPeriodicBoundaryProcess() {}
+
+  G4VParticleChange* PostStepDoIt(const G4Track& aTrack, const G4Step& aStep)
+  {
+    return this->template CrossBoundary<kFaceMask, Kind, Diagnostics>(aTrack, aStep);
+  }
+
+  G4VParticleChange* CrossPeriodicFace(const G4Track& aTrack, const G4Step& aStep,
+    const G4VTouchable* entered)
+  {
+    return this->template CrossPeriodicFaces<kFaceMask, Kind, Diagnostics>(aTrack,
+      aStep, entered);
+  }
+
+private:
+
+  //the pairs of faces of a box, triclinic or hexagonal cell that may be
+  //periodic; the third pair of sides of a hexagon needs both x and y
+  static const G4int kFaceMask =
+    ((AxisMask & fPeriodicX) ? (fFaceMinusX | fFacePlusX) : 0) |
+    ((AxisMask & fPeriodicY) ? (fFaceMinusY | fFacePlusY) : 0) |
+    ((AxisMask & fPeriodicZ) ? (fFaceMinusZ | fFacePlusZ) : 0) |
+    (((AxisMask & fPeriodicX) && (AxisMask & fPeriodicY)) ?
+      (fFaceMinusW | fFacePlusW) : 0);
+};
@@ -0,0 +1,83 @@
+#include "G4LogicalVolumePeriodic.hh"
+#include "G4PeriodicImageInformation.hh"
+
+#include "G4VPhysicalVolume.hh"
+#include "G4VTouchable.hh"
+
+void G4LogicalVolumePeriodic::SetFaceKind(G4int faces,
+  G4PeriodicBoundaryKind boundary)
+{
+  cyclic_faces &= ~faces;
+  reflecting_faces &= ~faces;
+  open_faces &= ~faces;
+
+  if (boundary == fCyclicBoundary) cyclic_faces |= faces;
+  else if (boundary == fReflectingBoundary) reflecting_faces |= faces;
+  else open_faces |= faces;
+}
+
+void G4LogicalVolumePeriodic::SetTiling(G4int n_a, G4int n_b, G4int n_c)
+{
+  tiling = CellIndex{{n_a, n_b, n_c}};
+}
+
+void G4LogicalVolumePeriodic::SetStartCell(G4int i, G4int j, G4int k)
+{
+  start_cell = CellIndex{{i, j, k}};
+}
+
+void G4LogicalVolumePeriodic::SetDefect(G4int i, G4int j, G4int k,
+  G4LogicalVolumePeriodic* defect)
+{
+  if (!defect || defect == this) {
+    G4ExceptionDescription ed;
+    ed << " The defect of cell " << i << " " << j << " " << k << " of "
+      << GetName() << " must be another periodic volume" << G4endl;
+    G4Exception("G4LogicalVolumePeriodic::SetDefect", "Periodic12",
+      FatalErrorInArgument, ed);
+    return;
+  }
+
+  defects[CellIndex{{i, j, k}}] = defect;
+  defect->array = this;
+}
+
+G4bool G4LogicalVolumePeriodic::IsTiled() const
+{
+  return tiling[0] > 0 || tiling[1] > 0 || tiling[2] > 0;
+}
+
+G4bool G4LogicalVolumePeriodic::IsInArray(const CellIndex& cell) const
+{
+  for (G4int i = 0; i < 3; ++i)
+    if (tiling[i] > 0 && (cell[i] < 0 || cell[i] >= tiling[i])) return false;
+  return true;
+}
+
+G4LogicalVolumePeriodic::CellIndex G4LogicalVolumePeriodic::GetCellIndex(
+  const G4Track* track) const
+{
+  CellIndex cell = GetArray()->start_cell;
+
+  //the image counts the cells crossed from the start cell
+  const G4PeriodicImageInformation* info = G4PeriodicImageInformation::Get(track);
+  if (info)
+    for (G4int i = 0; i < 3; ++i) cell[i] += info->GetImage(i);
+
+  return cell;
+}
+
+const G4LogicalVolumePeriodic* G4LogicalVolumePeriodic::Find(
+  const G4VTouchable* touchable)
+{
+  if (!touchable) return NULL;
+
+  for (G4int depth = 0; depth <= touchable->GetHistoryDepth(); ++depth) {
+    const G4LogicalVolumePeriodic* periodic =
+      dynamic_cast<const G4LogicalVolumePeriodic*>(
+        touchable->GetVolume(depth)->GetLogicalVolume());
+    if (periodic) return periodic;
+  }
+
+  return NULL;
+}
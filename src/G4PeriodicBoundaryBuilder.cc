@@ -2,11 +2,36 @@
 #include "G4LogicalVolumePeriodic.hh"
 
 #include "G4Box.hh"
+#include "G4GeometryTolerance.hh"
+#include "G4IntersectionSolid.hh"
+#include "G4Para.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4Point3D.hh"
+#include "G4Polycone.hh"
+#include "G4Polyhedra.hh"
 #include "G4PVPlacement.hh"
+#include "G4Region.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4ThreeVector.hh"
+#include "G4Tubs.hh"
 #include "G4VisAttributes.hh"
 
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+//the placements of a logical volume anywhere in the geometry
+G4int CountPlacements(const G4LogicalVolume *lv)
+{
+  G4int placements = 0;
+  for (auto pv : *G4PhysicalVolumeStore::GetInstance())
+    if (pv->GetLogicalVolume() == lv) placements++;
+  return placements;
+}
+
+}
+
 G4PeriodicBoundaryBuilder::G4PeriodicBoundaryBuilder()
 {
   logical_periodic = NULL;
@@ -16,10 +41,27 @@ G4PeriodicBoundaryBuilder::~G4PeriodicBoundaryBuilder()
 {
 }
 
+G4Box *G4PeriodicBoundaryBuilder::GetWorldBox(G4LogicalVolume *logical_world)
+{
+
+  G4Box *world = dynamic_cast<G4Box *>(logical_world->GetSolid());
+
+  if (!world) {
+    G4ExceptionDescription ed;
+    ed << " The world volume " << logical_world->GetName() << " is a "
+      << logical_world->GetSolid()->GetEntityType() << ", the periodic"
+      << " boundary builder requires a G4Box" << G4endl;
+    G4Exception("G4PeriodicBoundaryBuilder::Construct", "Periodic04",
+      FatalException, ed);
+  }
+
+  return world;
+}
+
 G4LogicalVolume *G4PeriodicBoundaryBuilder::Construct(G4LogicalVolume *logical_world)
 {
 
-  G4Box *world = (G4Box *)logical_world->GetSolid();
+  G4Box *world = GetWorldBox(logical_world);
 
   double buffer = 1 * micrometer;
 
@@ -36,13 +78,357 @@ G4LogicalVolume *G4PeriodicBoundaryBuilder::Construct(G4LogicalVolume *logical_w
   G4Box *periodic_world = new G4Box("cyclic", periodic_world_hx, periodic_world_hy,
                                     periodic_world_hz);
 
-  logical_periodic = new G4LogicalVolumePeriodic(periodic_world,
+  return PlaceCell(logical_world, periodic_world, G4ThreeVector());
+}
+
+G4LogicalVolume *G4PeriodicBoundaryBuilder::ConstructWedge(
+  G4LogicalVolume *logical_world, G4int n_fold, G4double r_min, G4double r_max,
+  G4double half_z, const G4ThreeVector &origin)
+{
+
+  G4Box *world = GetWorldBox(logical_world);
+
+  CheckFold(n_fold);
+
+  G4double delta_phi = 360*deg / n_fold;
+
+  G4Tubs *periodic_world = new G4Tubs("cyclic", r_min, r_max, half_z,
+                                      -0.5*delta_phi, delta_phi);
+
+  EncloseCell(world, periodic_world, origin);
+
+  return PlaceCell(logical_world, periodic_world, origin);
+}
+
+G4LogicalVolume *G4PeriodicBoundaryBuilder::ConstructWedge(
+  G4LogicalVolume *logical_world, G4int n_fold, G4int num_z_planes,
+  const G4double z_plane[], const G4double r_inner[], const G4double r_outer[],
+  const G4ThreeVector &origin)
+{
+
+  G4Box *world = GetWorldBox(logical_world);
+
+  CheckFold(n_fold);
+
+  G4double delta_phi = 360*deg / n_fold;
+
+  G4Polycone *periodic_world = new G4Polycone("cyclic", -0.5*delta_phi,
+                                              delta_phi, num_z_planes, z_plane,
+                                              r_inner, r_outer);
+
+  EncloseCell(world, periodic_world, origin);
+
+  return PlaceCell(logical_world, periodic_world, origin);
+}
+
+void G4PeriodicBoundaryBuilder::CheckFold(G4int n_fold)
+{
+  if (n_fold < 2) {
+    G4ExceptionDescription ed;
+    ed << " A wedge must be at most half of the ring, " << n_fold
+      << " fold symmetry was requested" << G4endl;
+    G4Exception("G4PeriodicBoundaryBuilder::ConstructWedge", "Periodic04",
+      FatalException, ed);
+  }
+}
+
+G4LogicalVolume *G4PeriodicBoundaryBuilder::ConstructArray(
+  G4LogicalVolume *logical_world, G4int n_x, G4int n_y)
+{
+
+  G4Box *world = GetWorldBox(logical_world);
+
+  double buffer = 1 * micrometer;
+
+  double cell_hx = world->GetXHalfLength() / n_x;
+  double cell_hy = world->GetYHalfLength() / n_y;
+  double cell_hz = world->GetZHalfLength();
+
+  //the centre of the start cell, which is off the centre of an even array
+  G4int start_x = n_x / 2;
+  G4int start_y = n_y / 2;
+  G4ThreeVector origin(-world->GetXHalfLength() + (2*start_x + 1) * cell_hx,
+                       -world->GetYHalfLength() + (2*start_y + 1) * cell_hy, 0.);
+
+  world->SetXHalfLength(world->GetXHalfLength() + buffer);
+  world->SetYHalfLength(world->GetYHalfLength() + buffer);
+  world->SetZHalfLength(world->GetZHalfLength() + buffer);
+
+  G4Box *periodic_world = new G4Box("cyclic", cell_hx, cell_hy, cell_hz);
+
+  PlaceCell(logical_world, periodic_world, origin);
+
+  logical_periodic->SetTiling(n_x, n_y, 0);
+  logical_periodic->SetStartCell(start_x, start_y, 0);
+
+  return logical_periodic;
+}
+
+G4LogicalVolume *G4PeriodicBoundaryBuilder::ConstructSymmetric(
+  G4LogicalVolume *logical_world, G4LogicalVolume *full_cell, G4bool mirror_x,
+  G4bool mirror_y, G4bool mirror_z, const G4ThreeVector &origin)
+{
+
+  G4Box *world = GetWorldBox(logical_world);
+
+  G4Box *full = dynamic_cast<G4Box *>(full_cell->GetSolid());
+
+  if (!full) {
+    G4ExceptionDescription ed;
+    ed << " The full cell " << full_cell->GetName() << " is a "
+      << full_cell->GetSolid()->GetEntityType() << ", a symmetric cell is"
+      << " reduced from a G4Box" << G4endl;
+    G4Exception("G4PeriodicBoundaryBuilder::ConstructSymmetric", "Periodic04",
+      FatalException, ed);
+    return NULL;
+  }
+
+  G4bool mirror[3] = {mirror_x, mirror_y, mirror_z};
+
+  //the reduced cell lies between the mirror planes and the plus faces
+  G4ThreeVector half(full->GetXHalfLength(), full->GetYHalfLength(),
+                     full->GetZHalfLength());
+  G4ThreeVector centre;
+  for (G4int i = 0; i < 3; ++i) {
+    if (!mirror[i]) continue;
+    half[i] *= 0.5;
+    centre[i] = half[i];
+  }
+
+  G4Box *periodic_world = new G4Box("cyclic", half.x(), half.y(), half.z());
+
+  EncloseCell(world, periodic_world, origin + centre);
+
+  PlaceCell(logical_world, periodic_world, origin + centre);
+
+  logical_periodic->SetMaterial(full_cell->GetMaterial());
+
+  if (mirror_x)
+    logical_periodic->SetFaceKind(fFaceMinusX | fFacePlusX, fReflectingBoundary);
+  if (mirror_y)
+    logical_periodic->SetFaceKind(fFaceMinusY | fFacePlusY, fReflectingBoundary);
+  if (mirror_z)
+    logical_periodic->SetFaceKind(fFaceMinusZ | fFacePlusZ, fReflectingBoundary);
+
+  ReduceDaughters(full_cell, logical_periodic, G4Transform3D(), centre, mirror,
+                  periodic_world);
+
+  return logical_periodic;
+}
+
+void G4PeriodicBoundaryBuilder::ReduceDaughters(G4LogicalVolume *source,
+  G4LogicalVolume *target, const G4Transform3D &to_full,
+  const G4ThreeVector &centre, const G4bool mirror[3], G4Box *cut)
+{
+
+  G4double tolerance =
+    G4GeometryTolerance::GetInstance()->GetSurfaceTolerance();
+
+  //the daughters are removed from the source as they are moved
+  std::vector<G4VPhysicalVolume *> daughters;
+  for (size_t i = 0; i < source->GetNoDaughters(); ++i)
+    daughters.push_back(source->GetDaughter(i));
+
+  for (auto pv : daughters) {
+
+    if (pv->IsReplicated()) {
+      G4ExceptionDescription ed;
+      ed << " The daughter " << pv->GetName() << " of " << source->GetName()
+        << " is replicated or parameterised, it cannot be reduced by symmetry"
+        << G4endl;
+      G4Exception("G4PeriodicBoundaryBuilder::ConstructSymmetric", "Periodic04",
+        FatalException, ed);
+      continue;
+    }
+
+    G4LogicalVolume *lv = pv->GetLogicalVolume();
+    G4Transform3D to_cell = to_full * G4Transform3D(pv->GetObjectRotationValue(),
+                                                    pv->GetObjectTranslation());
+
+    //the extent of the daughter in the full cell, from its bounding box
+    G4ThreeVector pmin, pmax;
+    lv->GetSolid()->BoundingLimits(pmin, pmax);
+
+    G4ThreeVector lower(kInfinity, kInfinity, kInfinity);
+    G4ThreeVector upper = -lower;
+    for (G4int corner = 0; corner < 8; ++corner) {
+      G4Point3D point = to_cell * G4Point3D((corner & 1) ? pmax.x() : pmin.x(),
+                                            (corner & 2) ? pmax.y() : pmin.y(),
+                                            (corner & 4) ? pmax.z() : pmin.z());
+      for (G4int i = 0; i < 3; ++i) {
+        lower[i] = std::min(lower[i], point[i]);
+        upper[i] = std::max(upper[i], point[i]);
+      }
+    }
+
+    G4bool outside = false, inside = true;
+    for (G4int i = 0; i < 3; ++i) {
+      if (!mirror[i]) continue;
+      if (upper[i] <= tolerance) outside = true;
+      if (lower[i] < -tolerance) inside = false;
+    }
+
+    //a daughter on the minus side of a mirror plane is its image
+    if (outside) {
+      source->RemoveDaughter(pv);
+      delete pv;
+      continue;
+    }
+
+    //a daughter across a mirror plane is cut by the reduced cell, given in
+    //its own frame, as are its daughters
+    if (!inside) {
+      G4VSolid *reduced = new G4IntersectionSolid(
+        lv->GetSolid()->GetName() + "_reduced", lv->GetSolid(), cut,
+        to_cell.inverse() * G4Translate3D(centre));
+
+      //a volume placed elsewhere as well is cut in a copy
+      if (CountPlacements(lv) > 1) {
+        lv = CloneVolume(lv, reduced);
+        pv->SetLogicalVolume(lv);
+      } else {
+        lv->SetSolid(reduced);
+      }
+
+      ReduceDaughters(lv, lv, to_cell, centre, mirror, cut);
+    }
+
+    if (target != source) {
+      source->RemoveDaughter(pv);
+      pv->SetTranslation(pv->GetTranslation() - centre);
+      pv->SetMotherLogical(target);
+      target->AddDaughter(pv);
+    }
+  }
+}
+
+G4LogicalVolume *G4PeriodicBoundaryBuilder::CloneVolume(G4LogicalVolume *lv,
+  G4VSolid *solid)
+{
+
+  G4LogicalVolume *clone = new G4LogicalVolume(solid, lv->GetMaterial(),
+    lv->GetName() + "_reduced", lv->GetFieldManager(),
+    lv->GetSensitiveDetector(), lv->GetUserLimits());
+  clone->SetVisAttributes(lv->GetVisAttributes());
+
+  //the daughters are placed again in the copy, and are cut or removed there
+  for (size_t i = 0; i < lv->GetNoDaughters(); ++i) {
+
+    G4VPhysicalVolume *daughter = lv->GetDaughter(i);
+
+    if (daughter->IsReplicated()) {
+      G4ExceptionDescription ed;
+      ed << " The daughter " << daughter->GetName() << " of " << lv->GetName()
+        << " is replicated or parameterised, it cannot be reduced by symmetry"
+        << G4endl;
+      G4Exception("G4PeriodicBoundaryBuilder::ConstructSymmetric", "Periodic04",
+        FatalException, ed);
+      continue;
+    }
+
+    new G4PVPlacement(daughter->GetRotation(), daughter->GetTranslation(),
+      daughter->GetLogicalVolume(), daughter->GetName(), clone, false,
+      daughter->GetCopyNo());
+  }
+
+  return clone;
+}
+
+G4LogicalVolume *G4PeriodicBoundaryBuilder::ConstructHexagonal(
+  G4LogicalVolume *logical_world, G4double apothem, G4double half_z,
+  const G4ThreeVector &origin)
+{
+
+  G4Box *world = GetWorldBox(logical_world);
+
+  /*a six sided polyhedra starting at -30 degrees has its side normals at 0,
+  60 and 120 degrees, and its z planes given as distances to the sides*/
+  G4double z_planes[2] = {-half_z, half_z};
+  G4double r_inner[2] = {0, 0};
+  G4double r_outer[2] = {apothem, apothem};
+
+  G4Polyhedra *periodic_world = new G4Polyhedra("cyclic", -30*deg, 360*deg, 6,
+                                                2, z_planes, r_inner, r_outer);
+
+  EncloseCell(world, periodic_world, origin);
+
+  return PlaceCell(logical_world, periodic_world, origin);
+}
+
+G4LogicalVolume *G4PeriodicBoundaryBuilder::ConstructTriclinic(
+  G4LogicalVolume *logical_world, const G4ThreeVector &a,
+  const G4ThreeVector &b, const G4ThreeVector &c, const G4ThreeVector &origin)
+{
+
+  G4Box *world = GetWorldBox(logical_world);
+
+  if (a.y() != 0. || a.z() != 0. || b.z() != 0. || c.z() <= 0.) {
+    G4ExceptionDescription ed;
+    ed << " Lattice vectors " << a << " " << b << " " << c << " cannot be"
+      << " described by a G4Para, a must lie along x, b in the xy plane and c"
+      << " must point along +z" << G4endl;
+    G4Exception("G4PeriodicBoundaryBuilder::ConstructTriclinic", "Periodic04",
+      FatalException, ed);
+  }
+
+  //the G4Para angles follow from the lattice vectors
+  G4double alpha = std::atan2(b.x(), b.y());
+  G4double theta = std::atan2(std::sqrt(c.x()*c.x() + c.y()*c.y()), c.z());
+  G4double phi = std::atan2(c.y(), c.x());
+
+  G4Para *periodic_world = new G4Para("cyclic", 0.5*a.x(), 0.5*b.y(), 0.5*c.z(),
+                                      alpha, theta, phi);
+
+  EncloseCell(world, periodic_world, origin);
+
+  return PlaceCell(logical_world, periodic_world, origin);
+}
+
+void G4PeriodicBoundaryBuilder::EncloseCell(G4Box *world, const G4VSolid *cell,
+  const G4ThreeVector &origin)
+{
+
+  double buffer = 1 * micrometer;
+
+  G4ThreeVector pmin, pmax;
+  cell->BoundingLimits(pmin, pmax);
+
+  /*enlarge the world volume if the cell does not fit inside it, keeping the
+  buffer between their surfaces*/
+  world->SetXHalfLength(std::max(world->GetXHalfLength(),
+    std::max(std::fabs(origin.x() + pmin.x()), std::fabs(origin.x() + pmax.x())) + buffer));
+  world->SetYHalfLength(std::max(world->GetYHalfLength(),
+    std::max(std::fabs(origin.y() + pmin.y()), std::fabs(origin.y() + pmax.y())) + buffer));
+  world->SetZHalfLength(std::max(world->GetZHalfLength(),
+    std::max(std::fabs(origin.z() + pmin.z()), std::fabs(origin.z() + pmax.z())) + buffer));
+}
+
+G4LogicalVolume *G4PeriodicBoundaryBuilder::PlaceCell(
+  G4LogicalVolume *logical_world, G4VSolid *cell, const G4ThreeVector &origin)
+{
+
+  logical_periodic = new G4LogicalVolumePeriodic(cell,
                                                  logical_world->GetMaterial(), "logical_periodic");
 
   logical_periodic->SetVisAttributes(G4Color::Magenta());
 
-  new G4PVPlacement(0, G4ThreeVector(), logical_periodic, "physical_cyclic",
+  new G4PVPlacement(0, origin, logical_periodic, "physical_cyclic",
                     logical_world, false, 0, true); //check for overlaps
 
   return logical_periodic;
 }
+
+G4Region *G4PeriodicBoundaryBuilder::ConstructEnvelope(const G4String &name)
+{
+
+  if (!logical_periodic) {
+    G4Exception("G4PeriodicBoundaryBuilder::ConstructEnvelope", "Periodic08",
+      FatalException, "No periodic volume has been constructed");
+    return NULL;
+  }
+
+  G4Region *envelope = new G4Region(name);
+  envelope->AddRootLogicalVolume(logical_periodic);
+
+  return envelope;
+}
@@ -1,45 +1,154 @@
 #include "G4PeriodicBoundaryPhysics.hh"
 #include "G4PeriodicBoundaryProcess.hh"
+#include "G4PeriodicNavigator.hh"
+#include "G4PeriodicStatisticsMessenger.hh"
+#include "G4PeriodicTransportation.hh"
+#include "G4TPeriodicBoundaryProcess.hh"
 
+#include "G4EventManager.hh"
+#include "G4OpticalPhoton.hh"
 #include "G4PhysicsConstructorFactory.hh"
 #include "G4ProcessManager.hh"
+#include "G4ProcessVector.hh"
+#include "G4PropagatorInField.hh"
+#include "G4SafetyHelper.hh"
+#include "G4SteppingManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4TrackingManager.hh"
+#include "G4TransportationManager.hh"
+#include "G4Version.hh"
 
 #include "globals.hh"
 
+#include <typeinfo>
+
 G4_DECLARE_PHYSCONSTR_FACTORY(G4PeriodicBoundaryPhysics);
 
+namespace {
+
+//the boundary process of each thread, for its end of run statistics
+G4ThreadLocal G4PeriodicBoundaryProcess* thread_process = 0;
+
+template <G4int AxisMask, G4PeriodicBoundaryKind Kind>
+G4PeriodicBoundaryProcess* NewPeriodicProcess(const G4String& name,
+  G4int diagnostics)
+{
+  if (diagnostics == G4PeriodicBoundaryProcess::kVerbose)
+    return new G4TPeriodicBoundaryProcess<AxisMask, Kind,
+      G4PeriodicBoundaryProcess::kVerbose>(name);
+  if (diagnostics == G4PeriodicBoundaryProcess::kStatistics)
+    return new G4TPeriodicBoundaryProcess<AxisMask, Kind,
+      G4PeriodicBoundaryProcess::kStatistics>(name);
+  return new G4TPeriodicBoundaryProcess<AxisMask, Kind,
+    G4PeriodicBoundaryProcess::kNoDiagnostics>(name);
+}
+
+template <G4int AxisMask>
+G4PeriodicBoundaryProcess* NewPeriodicProcess(const G4String& name,
+  G4bool reflecting, G4int diagnostics)
+{
+  if (reflecting)
+    return NewPeriodicProcess<AxisMask, fReflectingBoundary>(name, diagnostics);
+  return NewPeriodicProcess<AxisMask, fCyclicBoundary>(name, diagnostics);
+}
+
+}
+
 G4PeriodicBoundaryPhysics::G4PeriodicBoundaryPhysics(const G4String& name,
-  bool per_x, bool per_y, bool per_z, bool ref_walls)
+  bool per_x, bool per_y, bool per_z, bool ref_walls,
+  G4PeriodicBoundaryMode mode)
   : G4VPhysicsConstructor(name)
 {
 
   verboseLevel = 0;
   periodic_x = per_x; periodic_y = per_y; periodic_z = per_z;
   reflecting_walls = ref_walls;
+  boundary_mode = mode;
+
+  dispatch_mode = fDispatchPeriodicFace;
+  recovery_distance = 1*micrometer;
+  crossing_budget = 0;
+  budget_policy = fBudgetRoulette;
+  survival_probability = 0.5;
+  trajectory_mode = fTrajectoryAppend;
+  wrapped_safety = false;
+  statistics = true;
+  particle_policy = fAllButNeutrinos;
+
+  stats_messenger = new G4PeriodicStatisticsMessenger();
 
 }
 
 G4PeriodicBoundaryPhysics::~G4PeriodicBoundaryPhysics(){
+  delete stats_messenger;
+}
+
+G4PeriodicBoundaryProcess* G4PeriodicBoundaryPhysics::GetBoundaryProcess()
+{
+  return thread_process;
 }
 
 void G4PeriodicBoundaryPhysics::ConstructParticle()
 {
-  /*we construct the optical photon as the boundary process does not
-  currently apply to it, and this requires a test in the physics process */
+  /*the boundary process tells the optical photon apart, so it is
+  constructed even without optical physics*/
   G4OpticalPhoton::OpticalPhoton();
 
 }
 
 void G4PeriodicBoundaryPhysics::ConstructProcess(){
 
+  if (boundary_mode == fPeriodicNavigator) {
+    if (!reflecting_walls) {
+      ConstructNavigator();
+      return;
+    }
+    G4Exception("G4PeriodicBoundaryPhysics::ConstructProcess()", "Periodic07",
+      JustWarning, "The periodic navigator only applies cyclic conditions, the"
+      " periodic boundary process is used for reflecting walls");
+  }
+
+  /*a safety reaching across a face would let a step or a lateral displacement
+  of multiple scattering leave the cell unseen by the boundary process*/
+  if (wrapped_safety)
+    G4Exception("G4PeriodicBoundaryPhysics::ConstructProcess()", "Periodic15",
+      JustWarning, "The safety is only wrapped across periodic faces in the"
+      " fPeriodicNavigator mode, it is left as it is");
+
   if(verboseLevel > 0)
     G4cout << "Constructing cyclic boundary physics process" << G4endl;
 
-  G4PeriodicBoundaryProcess* pbc = new G4PeriodicBoundaryProcess("Cyclic",
-    fNotDefined, periodic_x, periodic_y, periodic_z, reflecting_walls);
+  G4PeriodicBoundaryProcess* pbc = CreateProcess("Cyclic");
+  thread_process = pbc;
 
   if(verboseLevel > 0) pbc->SetVerboseLevel(verboseLevel);
 
+  pbc->SetDispatchMode(dispatch_mode);
+  pbc->SetRegion(region_name);
+  pbc->SetParticlePolicy(particle_policy);
+  pbc->SetRecoveryDistance(recovery_distance);
+  pbc->SetCrossingBudget(crossing_budget);
+  pbc->SetBudgetPolicy(budget_policy);
+  pbc->SetSurvivalProbability(survival_probability);
+  pbc->SetTrajectoryMode(trajectory_mode);
+  for (auto name : listed_particles) pbc->AddParticle(name);
+  for (auto name : excluded_particles) pbc->ExcludeParticle(name);
+
+  //in transportation mode the boundary process is owned by the periodic
+  //transportation
+  G4PeriodicTransportation* transport = 0;
+  std::set<G4VProcess*> removed;
+  if (boundary_mode == fPeriodicTransportation) {
+#if G4VERSION_NUMBER >= 1100
+    transport = new G4PeriodicTransportation(pbc, verboseLevel);
+#else
+    //the touchable held by transportation cannot be updated after a crossing
+    G4Exception("G4PeriodicBoundaryPhysics::ConstructProcess()", "Periodic16",
+      JustWarning, "Wrapping inside transportation needs Geant4 11, the"
+      " periodic boundary process is used");
+#endif
+  }
+
   auto aParticleIterator=GetParticleIterator();
 
   aParticleIterator->reset();
@@ -63,9 +172,208 @@ void G4PeriodicBoundaryPhysics::ConstructProcess(){
     }
 
     if(pbc->IsApplicable(*particle)){
+
+      if (transport) {
+
+        G4VProcess* transportation = 0;
+        G4ProcessVector* processes = pManager->GetProcessList();
+        for (G4int i = 0; i < (G4int)processes->size(); ++i)
+          if ((*processes)[i]->GetProcessType() == fTransportation)
+            transportation = (*processes)[i];
+
+        if (ReplaceTransportation(pManager, transportation, transport)) {
+          removed.insert(transportation);
+          if(verboseLevel > 0)
+            G4cout << "Replacing transportation of " << particleName << G4endl;
+          continue;
+        }
+
+        /*coupled transportation propagates through the parallel geometries
+        with a navigator of its own, which the wrapping would leave behind*/
+        std::ostringstream o;
+        o << "Transportation of " << particleName << " is not a "
+          << "G4Transportation and cannot be wrapped, use the default "
+          << "fPeriodicBoundaryProcess mode";
+        G4Exception("G4PeriodicBoundaryPhysics::ConstructProcess()",
+          "Periodic17", FatalException, o.str().c_str());
+        return;
+      }
+
       if(verboseLevel > 0)
         G4cout << "Adding pbc to " << particleName << G4endl;
       pManager->AddDiscreteProcess(pbc);
+
+      /*an optical photon is cycled right after transportation, so that
+      G4OpBoundaryProcess sees the step end in the volume it lands in rather
+      than at an interface with the mother of the cell*/
+      if (particle == G4OpticalPhoton::OpticalPhotonDefinition())
+        pManager->SetProcessOrderingToSecond(pbc, idxPostStep);
     }
   }
+
+  DeleteTransportations(removed);
+}
+
+void G4PeriodicBoundaryPhysics::ConstructNavigator()
+{
+  if(verboseLevel > 0)
+    G4cout << "Constructing periodic navigator" << G4endl;
+
+  /*the geometry has been constructed, and the world handed to the navigator
+  in place, by the time the physics is. the transportation manager owns the
+  new navigator, and the replaced one is deleted below once nothing holds it*/
+  G4TransportationManager* manager =
+    G4TransportationManager::GetTransportationManager();
+
+  G4Navigator* previous = manager->GetNavigatorForTracking();
+
+  /*the parallel worlds are built with the mass world, before the physics. the
+  navigator only unfolds the mass world, a parallel world is navigated at the
+  unfolded position of the track and is not repeated*/
+  if (manager->GetNoWorlds() > 1)
+    G4Exception("G4PeriodicBoundaryPhysics::ConstructNavigator()", "Periodic18",
+      JustWarning, "Parallel worlds are not unfolded by the periodic navigator,"
+      " they see the unfolded position of each track. Use the"
+      " fPeriodicBoundaryProcess mode to score in a parallel world over the"
+      " cell");
+
+  G4PeriodicNavigator* navigator =
+    new G4PeriodicNavigator(periodic_x, periodic_y, periodic_z);
+  navigator->SetWorldVolume(previous->GetWorldVolume());
+  navigator->SetWrappedSafety(wrapped_safety);
+
+  manager->SetNavigatorForTracking(navigator);
+  manager->GetPropagatorInField()->SetNavigatorForPropagating(navigator);
+  manager->GetSafetyHelper()->InitialiseNavigator();
+
+  //the stepping manager keeps the navigator it was built with
+  G4EventManager* event_manager = G4EventManager::GetEventManager();
+  if (event_manager)
+    event_manager->GetTrackingManager()->GetSteppingManager()
+      ->SetNavigator(navigator);
+
+  //transportation keeps the navigator it was built with too, so each particle
+  //is given one built now
+  G4Transportation* transport = new G4Transportation(verboseLevel);
+
+  std::set<G4VProcess*> removed;
+  G4bool kept = false;
+
+  auto aParticleIterator=GetParticleIterator();
+
+  aParticleIterator->reset();
+
+  while( (*aParticleIterator)() ){
+
+    G4ParticleDefinition* particle = aParticleIterator->value();
+    G4ProcessManager* pManager = particle->GetProcessManager();
+
+    if (!pManager) continue;
+
+    G4VProcess* transportation = 0;
+    G4ProcessVector* processes = pManager->GetProcessList();
+    for (G4int i = 0; i < (G4int)processes->size(); ++i)
+      if ((*processes)[i]->GetProcessType() == fTransportation)
+        transportation = (*processes)[i];
+
+    if (!transportation) continue;
+
+    if (ReplaceTransportation(pManager, transportation, transport)) {
+      removed.insert(transportation);
+      continue;
+    }
+
+    kept = true;
+
+    std::ostringstream o;
+    o << "Transportation of " << particle->GetParticleName() << " is not a "
+      << "G4Transportation and is kept, its steps may end at periodic faces";
+    G4Exception("G4PeriodicBoundaryPhysics::ConstructNavigator()",
+      "Periodic05", JustWarning, o.str().c_str());
+  }
+
+  //the new transportation is not needed if no particle has taken it
+  if (removed.empty()) delete transport;
+  DeleteTransportations(removed);
+
+  //a transportation that is kept still steps with the replaced navigator
+  if (!kept) delete previous;
+}
+
+void G4PeriodicBoundaryPhysics::DeleteTransportations(
+  std::set<G4VProcess*>& removed)
+{
+  //a transportation is shared by the particles, and is only deleted once it
+  //has been taken from all of them
+  auto aParticleIterator=GetParticleIterator();
+
+  aParticleIterator->reset();
+
+  while( (*aParticleIterator)() ){
+
+    G4ProcessManager* pManager = aParticleIterator->value()->GetProcessManager();
+
+    if (!pManager) continue;
+
+    G4ProcessVector* processes = pManager->GetProcessList();
+    for (G4int i = 0; i < (G4int)processes->size(); ++i)
+      removed.erase((*processes)[i]);
+  }
+
+  for (auto process : removed) delete process;
+}
+
+G4bool G4PeriodicBoundaryPhysics::ReplaceTransportation(
+  G4ProcessManager* pManager, G4VProcess* transportation,
+  G4VProcess* periodic) const
+{
+  /*coupled transportation and other subclasses carry their own propagation
+  and are not replaced*/
+  if (!transportation || typeid(*transportation) != typeid(G4Transportation))
+    return false;
+
+  pManager->RemoveProcess(transportation);
+
+  //ordered as G4PhysicsListHelper orders transportation
+  pManager->AddProcess(periodic);
+  pManager->SetProcessOrderingToFirst(periodic, idxAlongStep);
+  pManager->SetProcessOrderingToFirst(periodic, idxPostStep);
+
+  return true;
+}
+
+G4PeriodicBoundaryProcess* G4PeriodicBoundaryPhysics::CreateProcess(
+  const G4String& name) const
+{
+  //the verbose output is only compiled in if it is asked for now, and the
+  //statistics unless they are switched off
+  G4int diagnostics = (verboseLevel > 0) ? G4PeriodicBoundaryProcess::kVerbose
+    : statistics ? G4PeriodicBoundaryProcess::kStatistics
+    : G4PeriodicBoundaryProcess::kNoDiagnostics;
+
+  G4int axes = (periodic_x ? fPeriodicX : 0) | (periodic_y ? fPeriodicY : 0)
+    | (periodic_z ? fPeriodicZ : 0);
+
+  switch (axes) {
+    case 0:
+      return NewPeriodicProcess<0>(name, reflecting_walls, diagnostics);
+    case fPeriodicX:
+      return NewPeriodicProcess<fPeriodicX>(name, reflecting_walls, diagnostics);
+    case fPeriodicY:
+      return NewPeriodicProcess<fPeriodicY>(name, reflecting_walls, diagnostics);
+    case fPeriodicX | fPeriodicY:
+      return NewPeriodicProcess<fPeriodicX | fPeriodicY>(name, reflecting_walls,
+        diagnostics);
+    case fPeriodicZ:
+      return NewPeriodicProcess<fPeriodicZ>(name, reflecting_walls, diagnostics);
+    case fPeriodicX | fPeriodicZ:
+      return NewPeriodicProcess<fPeriodicX | fPeriodicZ>(name, reflecting_walls,
+        diagnostics);
+    case fPeriodicY | fPeriodicZ:
+      return NewPeriodicProcess<fPeriodicY | fPeriodicZ>(name, reflecting_walls,
+        diagnostics);
+    default:
+      return NewPeriodicProcess<fPeriodicX | fPeriodicY | fPeriodicZ>(name,
+        reflecting_walls, diagnostics);
+  }
 }
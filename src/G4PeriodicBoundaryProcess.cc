@@ -1,13 +1,24 @@
 #include "G4PeriodicBoundaryProcess.hh"
-#include "G4EventManager.hh"
+#include "G4PeriodicImageInformation.hh"
 #include "G4GeometryTolerance.hh"
 #include "G4ios.hh"
+#include "G4FieldManager.hh"
 #include "G4LogicalVolumePeriodic.hh"
 #include "G4Navigator.hh"
 #include "G4ParticleChangeForPeriodic.hh"
-#include "G4TrackingManager.hh"
-#include "G4VTrajectory.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4ProcessManager.hh"
+#include "G4ProcessVector.hh"
+#include "G4PropagatorInField.hh"
+#include "G4RegionStore.hh"
+#include "G4NavigationHistory.hh"
+#include "G4OpticalPhoton.hh"
 #include "G4ParallelWorldProcess.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4VSolid.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
 
 G4PeriodicBoundaryProcess::G4PeriodicBoundaryProcess(const G4String& processName,
   G4ProcessType type, bool per_x, bool per_y, bool per_z, bool ref_walls) :
@@ -22,6 +33,42 @@ G4PeriodicBoundaryProcess::G4PeriodicBoundaryProcess(const G4String& processName
   periodic_y = per_y;
   periodic_z = per_z;
 
+  //without a cell the periodic world volume is treated as a centred box
+  periodic_mask = fNoFace;
+  if (periodic_x) periodic_mask |= (fFaceMinusX | fFacePlusX);
+  if (periodic_y) periodic_mask |= (fFaceMinusY | fFacePlusY);
+  if (periodic_z) periodic_mask |= (fFaceMinusZ | fFacePlusZ);
+
+  recovery_distance = 1*micrometer;
+
+  crossing_budget = 0;
+  track_crossings = 0;
+  budget_policy = fBudgetRoulette;
+  survival_probability = 0.5;
+
+  last_crossing_step = 0;
+  last_crossing_length = 0.;
+
+  current_track = NULL;
+  inherited_secondaries = 0;
+
+  trajectory_mode = fTrajectoryAppend;
+  trajectory = NULL;
+
+  dispatch_mode = fDispatchPeriodicFace;
+  particle_policy = fAllButNeutrinos;
+
+  region = NULL;
+  navigator = NULL;
+  field_propagator = NULL;
+  geometry_cached = false;
+
+  optical_photon = G4OpticalPhoton::OpticalPhotonDefinition();
+  parallel_relocation = false;
+
+  world_pv = NULL;
+  current = NULL;
+
   //the tolerance prevents trapped particles at boundaries
   kCarTolerance = G4GeometryTolerance::GetInstance()->GetSurfaceTolerance();
 
@@ -29,227 +76,1047 @@ G4PeriodicBoundaryProcess::G4PeriodicBoundaryProcess(const G4String& processName
 
 }
 
-G4PeriodicBoundaryProcess::~G4PeriodicBoundaryProcess(){}
+G4PeriodicBoundaryProcess::~G4PeriodicBoundaryProcess()
+{
+}
 
-G4VParticleChange*
-G4PeriodicBoundaryProcess::PostStepDoIt(const G4Track& aTrack, const G4Step& aStep)
+G4bool G4PeriodicBoundaryProcess::IsApplicable(const G4ParticleDefinition&
+  aParticleType)
 {
 
-  if ( verboseLevel > 0 )
-    G4cout << "G4PeriodicBoundaryPhysics::verboseLevel " << verboseLevel << G4endl;
+  const G4String& name = aParticleType.GetParticleName();
 
-  theStatus = Undefined;
+  if (excluded_particles.count(name)) return false;
 
-  fParticleChange.InitializeForPostStep(aTrack);
+  if (particle_policy == fListedOnly) return listed_particles.count(name) > 0;
 
-  const G4Step* pStep = &aStep;
+  //neutrinos leave the cell without interacting, there is nothing to cycle
+  G4int pdg = std::abs(aParticleType.GetPDGEncoding());
+  if (pdg == 12 || pdg == 14 || pdg == 16) return false;
 
-  G4bool isOnBoundary = (pStep->GetPostStepPoint()->GetStepStatus() == fGeomBoundary);
+  if (particle_policy == fChargedOnly) return aParticleType.GetPDGCharge() != 0.;
+  if (particle_policy == fNeutralOnly) return aParticleType.GetPDGCharge() == 0.;
 
-  if (!isOnBoundary) {
-    theStatus = NotAtBoundary;
-    if (verboseLevel > 0) BoundaryProcessVerbose();
-    return G4VDiscreteProcess::PostStepDoIt(aTrack, aStep);
-  }
+  return true;
+
+}
+
+void G4PeriodicBoundaryProcess::PreparePhysicsTable(const G4ParticleDefinition&)
+{
+  geometry_cached = false;
+}
+
+void G4PeriodicBoundaryProcess::BuildPhysicsTable(
+  const G4ParticleDefinition& particle)
+{
+  //the table is shared by all particles, so only build it once per run
+  if (!geometry_cached) CacheGeometry();
 
-  G4VPhysicalVolume* thePrePV = pStep->GetPreStepPoint()->GetPhysicalVolume();
-  G4VPhysicalVolume* thePostPV = pStep->GetPostStepPoint()->GetPhysicalVolume();
+  //the process managers are those of this thread
+  std::vector<G4ParallelWorldProcess*>& parallel = parallel_worlds[&particle];
+  parallel.clear();
 
-  if ( verboseLevel > 0 ) {
-    G4cout << " Particle at Boundary! " << G4endl;
-    if (thePrePV)  G4cout << " thePrePV:  " << thePrePV->GetName()  << G4endl;
-    if (thePostPV) G4cout << " thePostPV: " << thePostPV->GetName() << G4endl;
-    G4cout << "step length " << aTrack.GetStepLength() << G4endl;
+  G4ProcessManager* manager = particle.GetProcessManager();
+  if (!manager) return;
+
+  G4ProcessVector* processes = manager->GetProcessList();
+  for (G4int i = 0; i < (G4int)processes->size(); ++i) {
+    G4ParallelWorldProcess* process =
+      dynamic_cast<G4ParallelWorldProcess*>((*processes)[i]);
+    if (process) parallel.push_back(process);
   }
+}
+
+G4bool G4PeriodicBoundaryProcess::InRegion(const G4VPhysicalVolume* pv) const
+{
+  return (!region || pv->GetLogicalVolume()->GetRegion() == region);
+}
+
+void G4PeriodicBoundaryProcess::FlagVolumesAtFaces(
+  const PeriodicVolume& periodic, const G4VPhysicalVolume* pv,
+  const G4AffineTransform& to_cell, G4bool replicated)
+{
+
+  G4LogicalVolume* lvol = pv->GetLogicalVolume();
 
-  //avoid trapped particles at boundaries by testing for minimum step length
-	if (aTrack.GetStepLength() <= kCarTolerance/2){
-    theStatus = StepTooSmall;
-    if ( verboseLevel > 0) BoundaryProcessVerbose();
-    return G4VDiscreteProcess::PostStepDoIt(aTrack, aStep);
-	}
+  for (size_t i = 0; i < lvol->GetNoDaughters(); ++i) {
+
+    G4VPhysicalVolume* daughter = lvol->GetDaughter(i);
+
+    G4bool daughter_replicated = replicated || daughter->IsReplicated();
+
+    G4AffineTransform daughter_to_cell = G4AffineTransform(
+      daughter->GetRotation(), daughter->GetTranslation()) * to_cell;
+
+    //the placement of replicas and parameterised volumes varies with the copy
+    //number, so they are always assumed to reach the faces
+    G4bool at_face = daughter_replicated;
+
+    if (!at_face) {
+
+      G4ThreeVector pmin, pmax;
+      daughter->GetLogicalVolume()->GetSolid()->BoundingLimits(pmin, pmax);
+
+      //bounding box of the eight transformed corners, in the cell frame
+      G4ThreeVector cmin(kInfinity, kInfinity, kInfinity);
+      G4ThreeVector cmax(-kInfinity, -kInfinity, -kInfinity);
+
+      for (G4int c = 0; c < 8; ++c) {
+        G4ThreeVector corner((c & 1) ? pmax.x() : pmin.x(),
+                             (c & 2) ? pmax.y() : pmin.y(),
+                             (c & 4) ? pmax.z() : pmin.z());
+        corner = daughter_to_cell.TransformPoint(corner);
+        for (G4int k = 0; k < 3; ++k) {
+          cmin[k] = std::min(cmin[k], corner[k]);
+          cmax[k] = std::max(cmax[k], corner[k]);
+        }
+      }
 
-  const G4DynamicParticle* aParticle = aTrack.GetDynamicParticle();
+      at_face = (periodic.cell.FacesReached(cmin, cmax) & periodic.periodic_mask)
+        != fNoFace;
+    }
 
-  // store the current values
-	OldMomentum = aParticle->GetMomentumDirection();
-	OldPolarization = aParticle->GetPolarization();
-  OldPosition = pStep->GetPostStepPoint()->GetPosition();
-  NewPosition = OldPosition;
+    if (at_face && InRegion(daughter))
+      volume_flags[daughter->GetInstanceID()] |= kForcedFrom;
 
-  if ( verboseLevel > 0 ) {
-     G4cout << " Old Momentum Direction: " << OldMomentum << G4endl;
-     G4cout << " Old Position: " << NewPosition << G4endl;
+    FlagVolumesAtFaces(periodic, daughter, daughter_to_cell, daughter_replicated);
   }
 
-  G4ThreeVector theGlobalPoint = pStep->GetPostStepPoint()->GetPosition();
+}
 
-  // calculation of the global normal. code adapted from G4OpBoundaryProcess
+void G4PeriodicBoundaryProcess::CacheGeometry()
+{
 
-  G4bool valid;
-  //  Use the new method for Exit Normal in global coordinates,
-  //    which provides the normal more reliably.
-  theGlobalNormal = G4TransportationManager::GetTransportationManager()\
-    ->GetNavigatorForTracking()->GetGlobalExitNormal(theGlobalPoint,&valid);
+  region = NULL;
 
-  if (valid) {
-    theGlobalNormal = -theGlobalNormal;
+  if (!region_name.empty()) {
+    region = G4RegionStore::GetInstance()->GetRegion(region_name, false);
+    if (!region) {
+      G4ExceptionDescription ed;
+      ed << " Region " << region_name << " does not exist, the periodic"
+        << " boundary process is applied in all regions" << G4endl;
+      G4Exception("G4PeriodicBoundaryProcess::CacheGeometry", "Periodic02",
+        JustWarning, ed);
+    }
   }
-  else {
-    G4cout << "global normal " << theGlobalNormal << G4endl;
-    G4ExceptionDescription ed;
-    ed << " G4PeriodicBoundaryProcess/PostStepDoIt(): "
-      << " The Navigator reports that it returned an invalid normal" << G4endl;
-    G4Exception("G4PeriodicBoundaryProcess::PostStepDoIt", "PerBoun01",
-      EventMustBeAborted,ed,
-      "Invalid Surface Normal - Geometry must return valid surface normal");
+
+  G4PhysicalVolumeStore* pv_store = G4PhysicalVolumeStore::GetInstance();
+
+  G4int max_id = -1;
+  for (auto pv : *pv_store) max_id = std::max(max_id, pv->GetInstanceID());
+
+  volume_flags.assign(max_id + 1, 0);
+
+  //the transportation manager is per thread, as is this process
+  navigator = G4TransportationManager::GetTransportationManager()
+    ->GetNavigatorForTracking();
+  field_propagator = G4TransportationManager::GetTransportationManager()
+    ->GetPropagatorInField();
+
+  world_pv = navigator->GetWorldVolume();
+
+  periodic_volumes.clear();
+  periodic_index.assign(max_id + 1, -1);
+  current = NULL;
+
+  if (world_pv) {
+    G4NavigationHistory history;
+    history.SetFirstEntry(world_pv);
+    FindPeriodicVolumes(history);
   }
 
-  if (OldMomentum * theGlobalNormal > 0.0) {
+  ResolveArrays();
 
-    if ( verboseLevel > 0 ) {
+  G4bool all_cells = !periodic_volumes.empty();
+  for (auto& periodic : periodic_volumes) all_cells = all_cells && periodic.has_cell;
 
-      G4cout << "theGlobalNormal points in a wrong direction." << G4endl;
-      G4cout << "Invalid Surface Normal - Geometry must return valid surface \
-        normal pointing in the right direction" << G4endl;
+  if (dispatch_mode == fDispatchEveryStep || !all_cells) {
 
+    if (dispatch_mode != fDispatchEveryStep) {
+      G4ExceptionDescription ed;
+      ed << " A periodic volume that is not a box, parallelepiped, hexagonal"
+        << " prism or wedge, or no periodic volume, was found in the world"
+        << " volume, the periodic boundary process is forced on every step"
+        << G4endl;
+      G4Exception("G4PeriodicBoundaryProcess::CacheGeometry", "Periodic03",
+        JustWarning, ed);
     }
 
-    theGlobalNormal = -theGlobalNormal;
+    for (auto pv : *pv_store)
+      if (InRegion(pv)) volume_flags[pv->GetInstanceID()] |= kForcedFrom;
+
+  } else {
+
+    //steps starting in a periodic volume itself reach its faces, as do steps
+    //starting in any daughter whose extent coincides with a periodic face
+    for (auto& periodic : periodic_volumes) {
+      if (InRegion(periodic.pv))
+        volume_flags[periodic.pv->GetInstanceID()] |= kForcedFrom;
+      FlagVolumesAtFaces(periodic, periodic.pv, periodic.volume_to_cell, false);
+    }
+
+  }
+
+  if (verboseLevel > 0) {
+    G4int nforced = 0;
+    for (auto flags : volume_flags) if (flags & kForcedFrom) nforced++;
+    G4cout << GetProcessName() << " forced in " << nforced << " of "
+      << pv_store->size() << " physical volumes" << G4endl;
   }
 
-  /*when the post step point is in the world volume, the eldest daughter will
-  be the periodic world volume, which has a skin associated. so we cycle or reflect*/
+  geometry_cached = true;
+
+}
+
+void G4PeriodicBoundaryProcess::FindPeriodicVolumes(
+  G4NavigationHistory& history)
+{
+
+  G4VPhysicalVolume* mother = history.GetTopVolume();
+  G4LogicalVolume* lmother = mother->GetLogicalVolume();
+
+  for (size_t i = 0; i < lmother->GetNoDaughters(); ++i) {
+
+    G4VPhysicalVolume* daughter = lmother->GetDaughter(i);
 
-  G4LogicalVolume* lvol = thePostPV->GetLogicalVolume();
+    //the copies of a replica share one physical volume, they are not searched
+    if (daughter->IsReplicated()) continue;
 
-  if ( verboseLevel > 0 ) 
-    G4cout << "Post step logical " << lvol->GetName() << G4endl;
+    history.NewLevel(daughter, kNormal, daughter->GetCopyNo());
 
-  G4LogicalVolume* dlvol = NULL;
+    G4LogicalVolumePeriodic* lv =
+      dynamic_cast<G4LogicalVolumePeriodic*>(daughter->GetLogicalVolume());
 
-  if (lvol->GetNoDaughters() > 0) {
+    if (lv && periodic_index[daughter->GetInstanceID()] >= 0) {
+      G4ExceptionDescription ed;
+      ed << " The periodic volume " << daughter->GetName() << " is placed"
+        << " more than once in the world, its first placement is periodic"
+        << G4endl;
+      G4Exception("G4PeriodicBoundaryProcess::FindPeriodicVolumes",
+        "Periodic11", JustWarning, ed);
+    } else if (lv) {
+
+      PeriodicVolume periodic;
+      periodic.pv = daughter;
+      periodic.lv = lv;
+      periodic.array = -1;
+      periodic.to_world = history.GetTopTransform().Inverse();
+
+      G4bool per_x = periodic_x, per_y = periodic_y, per_z = periodic_z;
+      G4PeriodicBoundaryKind kind = reflecting_walls ? fReflectingBoundary
+        : fCyclicBoundary;
+
+      G4int cyclic_faces, reflecting_faces, open_faces;
+
+      G4bool own_axes = lv->GetPeriodicAxes(per_x, per_y, per_z);
+      G4bool own_kind = lv->GetBoundaryKind(kind);
+      G4bool own_faces = lv->GetFaceKinds(cyclic_faces, reflecting_faces,
+        open_faces);
+
+      periodic.specialised = !(own_axes && (per_x != periodic_x
+        || per_y != periodic_y || per_z != periodic_z))
+        && !(own_kind && kind != (reflecting_walls ? fReflectingBoundary
+        : fCyclicBoundary)) && !own_faces;
+
+      periodic.has_cell = periodic.cell.Build(lv->GetSolid(), periodic.to_world,
+        kCarTolerance, periodic.volume_to_cell);
+
+      //without a cell the volume is treated as a centred box
+      G4int cell_faces;
+      if (periodic.has_cell) {
+        periodic.periodic_mask = periodic.cell.GetPeriodicMask(per_x, per_y, per_z);
+        cell_faces = periodic.cell.GetPeriodicMask(true, true, true);
+      } else {
+        periodic.periodic_mask = fNoFace;
+        if (per_x) periodic.periodic_mask |= (fFaceMinusX | fFacePlusX);
+        if (per_y) periodic.periodic_mask |= (fFaceMinusY | fFacePlusY);
+        if (per_z) periodic.periodic_mask |= (fFaceMinusZ | fFacePlusZ);
+        cell_faces = fFaceMinusX | fFacePlusX | fFaceMinusY | fFacePlusY
+          | fFaceMinusZ | fFacePlusZ;
+      }
+
+      if (kind == fOpenBoundary) periodic.periodic_mask = fNoFace;
+      periodic.reflecting_mask = (kind == fReflectingBoundary) ?
+        periodic.periodic_mask : fNoFace;
+
+      //the faces given a kind of their own override the axes and the kind
+      if (own_faces) {
+        periodic.periodic_mask = (periodic.periodic_mask | cyclic_faces
+          | reflecting_faces) & ~open_faces & cell_faces;
+        periodic.reflecting_mask = ((periodic.reflecting_mask & ~cyclic_faces)
+          | reflecting_faces) & periodic.periodic_mask;
+
+        //a particle cycled through a face lands on the opposite one
+        G4int cyclic = periodic.periodic_mask & ~periodic.reflecting_mask;
+        G4int unpaired = fNoFace;
+        for (G4int face = fFaceMinusX; face <= fFacePlusW; face <<= 1)
+          if ((cyclic & face) && !(cyclic & G4PeriodicCell::GetOppositeFace(face)))
+            unpaired |= face;
+        if (unpaired) {
+          G4ExceptionDescription ed;
+          ed << " The cyclic faces " << unpaired << " of the periodic volume "
+            << daughter->GetName() << " are not opposite a cyclic face, they"
+            << " are left open" << G4endl;
+          G4Exception("G4PeriodicBoundaryProcess::FindPeriodicVolumes",
+            "Periodic14", JustWarning, ed);
+          periodic.periodic_mask &= ~unpaired;
+        }
+      }
+
+      periodic.reflecting = periodic.reflecting_mask != fNoFace
+        && periodic.reflecting_mask == periodic.periodic_mask;
 
-    if ( verboseLevel > 0 )
-      G4cout << "eldest daughter " << lvol->GetDaughter(0)->GetName()<< G4endl;
+      IndexLandingVolumes(periodic, history);
 
-    dlvol = lvol->GetDaughter(0)->GetLogicalVolume();
+      periodic_index[daughter->GetInstanceID()] = periodic_volumes.size();
+      periodic_volumes.push_back(periodic);
 
+      //a crossing into the mother from the periodic volume is a periodic
+      //crossing
+      volume_flags[mother->GetInstanceID()] |= kPeriodicMother;
+
+      if (verboseLevel > 0)
+        G4cout << GetProcessName() << " periodic volume " << daughter->GetName()
+          << " periodic faces " << periodic.periodic_mask << " reflecting faces "
+          << periodic.reflecting_mask << G4endl;
+    }
+
+    //periodic volumes may be nested in one another
+    FindPeriodicVolumes(history);
+
+    history.BackLevel();
   }
 
-  if (dlvol && dlvol->IsExtended()){
+}
 
-    if (verboseLevel > 0) G4cout << " Logical surface, periodic " << G4endl;
+void G4PeriodicBoundaryProcess::ResolveArrays()
+{
+
+  for (size_t i = 0; i < periodic_volumes.size(); ++i) {
 
-    bool on_x = theGlobalNormal.isParallel(G4ThreeVector(1,0,0));
-    bool on_y = theGlobalNormal.isParallel(G4ThreeVector(0,1,0));
-    bool on_z = theGlobalNormal.isParallel(G4ThreeVector(0,0,1));
+    PeriodicVolume& tiled = periodic_volumes[i];
 
-    //make sure that we are at a plane
-    bool on_plane = (on_x || on_y || on_z);
+    //a defect is resolved from the volume tiling its array
+    if (!tiled.lv->IsTiled() || tiled.lv->GetArray() != tiled.lv) continue;
 
-    if(!on_plane){
+    if (!tiled.has_cell || tiled.reflecting) {
       G4ExceptionDescription ed;
-      ed << " G4PeriodicBoundaryProcess/PostStepDoIt(): "
-        << " The particle is not on a surface of the cyclic world" << G4endl;
-      G4Exception("G4PeriodicBoundaryProcess::PostStepDoIt", "Periodic01",
-        EventMustBeAborted,ed,
-        "Periodic boundary process must only occur for particle on periodic world surface");
-    } else {
+      ed << " The periodic volume " << tiled.pv->GetName() << " is tiled but"
+        << " is not a cyclic box, parallelepiped, hexagonal prism or wedge,"
+        << " it is not treated as a finite array" << G4endl;
+      G4Exception("G4PeriodicBoundaryProcess::ResolveArrays", "Periodic13",
+        JustWarning, ed);
+      continue;
+    }
+
+    tiled.array = i;
+
+    for (auto& defect : tiled.lv->GetDefects()) {
+
+      G4int found = -1;
+      for (size_t j = 0; j < periodic_volumes.size(); ++j)
+        if (periodic_volumes[j].lv == defect.second) found = j;
+
+      //a defect must be the same cell as the array, placed elsewhere
+      G4bool same_cell = found >= 0 && periodic_volumes[found].has_cell;
+      for (G4int k = 0; same_cell && k < 3; ++k) {
+        const G4PeriodicCell& a = tiled.cell;
+        const G4PeriodicCell& b = periodic_volumes[found].cell;
+        same_cell = (a.GetCellToWorld().TransformAxis(a.GetLatticeVector(k))
+          - b.GetCellToWorld().TransformAxis(b.GetLatticeVector(k))).mag()
+          <= kCarTolerance && a.GetShape() == b.GetShape();
+      }
+
+      if (!same_cell) {
+        G4ExceptionDescription ed;
+        ed << " The defect " << defect.second->GetName() << " of "
+          << tiled.pv->GetName() << " is not placed, or is not the same cell,"
+          << " the cell " << defect.first[0] << " " << defect.first[1] << " "
+          << defect.first[2] << " is left as it is" << G4endl;
+        G4Exception("G4PeriodicBoundaryProcess::ResolveArrays", "Periodic13",
+          JustWarning, ed);
+        continue;
+      }
 
-      bool on_x_and_periodic = (on_x && periodic_x);
-      bool on_y_and_periodic = (on_y && periodic_y);
-      bool on_z_and_periodic = (on_z && periodic_z);
+      //the defect is crossed as the array is
+      PeriodicVolume& replacement = periodic_volumes[found];
+      replacement.array = i;
+      replacement.reflecting = false;
+      replacement.reflecting_mask = tiled.reflecting_mask;
+      replacement.specialised = tiled.specialised;
+      replacement.periodic_mask = tiled.periodic_mask;
 
-      bool on_a_periodic_plane = 
-        (on_x_and_periodic || on_y_and_periodic || on_z_and_periodic);
+      tiled.defects[defect.first] = found;
+    }
 
-      if (on_a_periodic_plane) {
+    if (verboseLevel > 0)
+      G4cout << GetProcessName() << " virtual array " << tiled.pv->GetName()
+        << " of " << tiled.lv->GetTiling()[0] << " x "
+        << tiled.lv->GetTiling()[1] << " x " << tiled.lv->GetTiling()[2]
+        << " cells, " << tiled.defects.size() << " defects" << G4endl;
+  }
 
-        if (verboseLevel > 0) G4cout << " on periodic plane " << G4endl;
+}
 
-        if(reflecting_walls){ // we are periodic through specular reflection
+G4int G4PeriodicBoundaryProcess::ArrayFaces(const G4Track& track,
+  G4int faces) const
+{
+  const G4LogicalVolumePeriodic* array = periodic_volumes[current->array].lv;
 
-          if (verboseLevel > 0) G4cout << " reflecting " << G4endl;
+  G4LogicalVolumePeriodic::CellIndex cell = array->GetCellIndex(&track);
 
-          G4double PdotN = OldMomentum * theGlobalNormal;
-          NewMomentum = OldMomentum - (2.0 * PdotN) * theGlobalNormal;
-          G4double EdotN = OldPolarization * theGlobalNormal;
-          NewPolarization = -OldPolarization + (2.*EdotN)*theGlobalNormal;
-          theStatus = Reflection;
+  G4int inside = fNoFace;
 
-          NewMomentum = NewMomentum.unit();//unit vector
-          NewPolarization = NewPolarization.unit();
+  for (G4int face = fFaceMinusX; face <= fFacePlusW; face <<= 1) {
+    if (!(faces & face)) continue;
 
-          if (verboseLevel > 0) {
-            G4cout << " New Momentum Direction: " << NewMomentum << G4endl;
-            G4cout << " New Polarization:       " << NewPolarization << G4endl;
-            BoundaryProcessVerbose();
-          }
+    const G4int* shift = current->cell.GetImageShift(face);
+    G4int sign = G4PeriodicCell::IsPlusFace(face) ? 1 : -1;
 
-          fParticleChange.ProposeMomentumDirection(NewMomentum);
-          fParticleChange.ProposePolarization(NewPolarization);
+    G4LogicalVolumePeriodic::CellIndex next = cell;
+    for (G4int i = 0; i < 3; ++i) next[i] += sign * shift[i];
 
-        } else { // we are periodic through cyclic
+    if (array->IsInArray(next)) inside |= face;
+  }
 
-          theStatus = Cycling;
+  return inside;
+}
 
-          if ( verboseLevel > 0) G4cout << " periodic " << G4endl;
+void G4PeriodicBoundaryProcess::MoveToTile(const G4Track& track,
+  G4ThreeVector& position)
+{
+  PeriodicVolume& tiled = periodic_volumes[current->array];
 
-          if ( verboseLevel > 0) G4cout << "Global normal " << theGlobalNormal << G4endl;
+  auto defect = tiled.defects.find(tiled.lv->GetCellIndex(&track));
 
-          //translate a component of the position vector according to which plane we are on
-          if (on_x_and_periodic) 
-            NewPosition.setX(-NewPosition.x());
-          else if (on_y_and_periodic) 
-            NewPosition.setY(-NewPosition.y());
-          else if (on_z_and_periodic) 
-            NewPosition.setZ(-NewPosition.z());
-          else
-            G4cout << "global normal does not belong to periodic plane!!" << G4endl;
+  PeriodicVolume* tile = (defect == tiled.defects.end()) ? &tiled
+    : &periodic_volumes[defect->second];
 
-          NewMomentum = OldMomentum.unit();
-          NewPolarization = OldPolarization.unit();
+  if (tile == current) return;
 
-          if (verboseLevel > 0) {
-            G4cout << " New Position: " << NewPosition << G4endl;
-            G4cout << " New Momentum Direction: " << NewMomentum << G4endl;
-            G4cout << " New Polarization:       " << NewPolarization << G4endl;
-            BoundaryProcessVerbose();
-          }
+  //the same point of the cell in the other volume, in the same image
+  G4ThreeVector shift = tile->cell.GetCellToWorld().NetTranslation()
+    - current->cell.GetCellToWorld().NetTranslation();
 
-          fParticleChange.ProposeMomentumDirection(NewMomentum);
-          fParticleChange.ProposePolarization(NewPolarization);
-          fParticleChange.ProposePosition(NewPosition);
+  position += shift;
 
-          //we must notify the navigator that we have moved the particle artificially
-          G4Navigator* gNavigator =
-            G4TransportationManager::GetTransportationManager()
-            ->GetNavigatorForTracking();
-          //Locates the volume containing the specified global point.
+  G4PeriodicImageInformation::Get(&track)->AddOffset(-shift);
 
-          gNavigator->SetGeometricallyLimitedStep() ;
-          //gNavigator->LocateGlobalPointWithinVolume(NewPosition);
-          gNavigator->LocateGlobalPointAndSetup( NewPosition,
-                                                &NewMomentum,
-                                               true,
-                                               false) ;//do not ignore direction
-          gNavigator->ComputeSafety(NewPosition);
+  current = tile;
+}
 
+G4VParticleChange* G4PeriodicBoundaryProcess::LeaveArray(const G4Track& track,
+  const G4Step& step, const G4ThreeVector& position,
+  const G4ThreeVector& direction)
+{
 
-          //force drawing of the step prior to periodic the particle
-          G4EventManager* evtm = G4EventManager::GetEventManager();
-          G4TrackingManager* tckm = evtm->GetTrackingManager();
-          G4VTrajectory* fpTrajectory = NULL;
-          fpTrajectory = tckm->GimmeTrajectory();
-          if (fpTrajectory) fpTrajectory->AppendStep(pStep);
+  theStatus = LeftArray;
 
-        }
+  //secondaries created so far belong to the image being left
+  PassImageToSecondaries(step.GetSecondary());
+
+  G4ThreeVector unwrapped =
+    G4PeriodicImageInformation::Unwrap(&track, position);
+
+  if (verboseLevel > 0) {
+    G4cout << " leaving the array at " << unwrapped << G4endl;
+    BoundaryProcessVerbose();
+  }
+
+  /*an array whose edge absorbs kills the track on the face, and it keeps its
+  image so that it may still be unwrapped*/
+  if (periodic_volumes[current->array].lv->GetKillAtEdge()) {
+    statistics.CountArrayKill(track.GetWeight()*track.GetKineticEnergy());
+    fParticleChange.ProposeTrackStatus(fStopAndKill);
+    if (trajectory) RecordTrajectory(track, step);
+    return &fParticleChange;
+  }
+
+  statistics.CountArrayExit();
+
+  G4PeriodicImageInformation* info = G4PeriodicImageInformation::Get(&track);
+
+  //out of a wedge the particle is turned back to where it is in the ring
+  G4ThreeVector unwrapped_direction =
+    G4PeriodicImageInformation::UnwrapDirection(&track, direction);
+  fParticleChange.ProposeMomentumDirection(unwrapped_direction);
+  fParticleChange.ProposePolarization(G4PeriodicImageInformation::UnwrapDirection(
+    &track, track.GetPolarization()));
+
+  if (info) info->Reset();
+
+  fParticleChange.ProposePosition(unwrapped);
+  parallel_relocation = true;
+
+  //the array may reach the surface of the world
+  if (!Relocate(fNoFace, unwrapped, unwrapped_direction))
+    fParticleChange.ProposeTrackStatus(fStopAndKill);
+
+  if (trajectory) RecordTrajectory(track, step);
+
+  return &fParticleChange;
+
+}
+
+void G4PeriodicBoundaryProcess::ClearLandingVolumes(PeriodicVolume& periodic)
+{
+  periodic.cell_touchable = G4TouchableHandle();
+
+  for (G4int f = 0; f < kFaces; ++f) {
+    periodic.landing_volumes[f].clear();
+    periodic.full_relocation[f] = true;
+  }
+}
+
+void G4PeriodicBoundaryProcess::IndexLandingVolumes(PeriodicVolume& periodic,
+  const G4NavigationHistory& history)
+{
+
+  ClearLandingVolumes(periodic);
+
+  if (!periodic.has_cell) return;
+
+  periodic.cell_touchable = new G4TouchableHistory(history);
+
+  for (G4int f = 0; f < kFaces; ++f) periodic.full_relocation[f] = false;
+
+  G4LogicalVolume* lvol = periodic.pv->GetLogicalVolume();
+
+  for (size_t i = 0; i < lvol->GetNoDaughters(); ++i) {
+
+    G4VPhysicalVolume* daughter = lvol->GetDaughter(i);
+
+    G4AffineTransform daughter_to_cell = G4AffineTransform(
+      daughter->GetRotation(), daughter->GetTranslation())
+      * periodic.volume_to_cell;
+
+    G4ThreeVector pmin, pmax;
+    daughter->GetLogicalVolume()->GetSolid()->BoundingLimits(pmin, pmax);
+
+    G4ThreeVector cmin(kInfinity, kInfinity, kInfinity);
+    G4ThreeVector cmax(-kInfinity, -kInfinity, -kInfinity);
+
+    for (G4int c = 0; c < 8; ++c) {
+      G4ThreeVector corner((c & 1) ? pmax.x() : pmin.x(),
+                           (c & 2) ? pmax.y() : pmin.y(),
+                           (c & 4) ? pmax.z() : pmin.z());
+      corner = daughter_to_cell.TransformPoint(corner);
+      for (G4int k = 0; k < 3; ++k) {
+        cmin[k] = std::min(cmin[k], corner[k]);
+        cmax[k] = std::max(cmax[k], corner[k]);
       }
     }
+
+    G4int reached = periodic.cell.FacesReached(cmin, cmax);
+
+    for (G4int f = 0; f < kFaces; ++f) {
+
+      //a particle crossing face f lands on the opposite face
+      if (!(reached & (1 << (f ^ 1)))) continue;
+
+      //replicas and parameterised volumes cannot be tested analytically
+      if (daughter->IsReplicated()) {
+        periodic.full_relocation[f] = true;
+        continue;
+      }
+
+      G4NavigationHistory daughter_history(history);
+      daughter_history.NewLevel(daughter, kNormal, daughter->GetCopyNo());
+
+      LandingVolume landing;
+      landing.pv = daughter;
+      landing.cell_to_local = daughter_to_cell.Inverse();
+      landing.touchable = new G4TouchableHistory(daughter_history);
+
+      periodic.landing_volumes[f].push_back(landing);
+    }
   }
 
-  return &fParticleChange;
+  if (verboseLevel > 0) {
+    for (G4int f = 0; f < kFaces; ++f)
+      G4cout << GetProcessName() << " face " << f << " landing volumes "
+        << periodic.landing_volumes[f].size()
+        << (periodic.full_relocation[f] ? " (full relocation)" : "") << G4endl;
+  }
+
+}
+
+G4PeriodicBoundaryProcess::PeriodicVolume*
+G4PeriodicBoundaryProcess::FindPeriodicVolume(const G4Step& step,
+  const G4VTouchable* entered)
+{
+  const G4VTouchable* pre = step.GetPreStepPoint()->GetTouchable();
+
+  if (!pre || !entered) return NULL;
+
+  //the volume left is the ancestor of the pre step volume one level below
+  //the mother entered, whichever daughter of it the step started in
+  G4int levels = pre->GetHistoryDepth() - entered->GetHistoryDepth() - 1;
+  if (levels < 0) return NULL;
+
+  const G4VPhysicalVolume* left = pre->GetVolume(levels);
+  size_t id = left->GetInstanceID();
+
+  if (id >= periodic_index.size() || periodic_index[id] < 0) return NULL;
+
+  PeriodicVolume* periodic = &periodic_volumes[periodic_index[id]];
+
+  //only the first placement of a volume placed several times is periodic
+  if ((pre->GetTranslation(levels) - periodic->to_world.NetTranslation()).mag()
+      > kCarTolerance) return NULL;
+
+  return periodic;
+}
+
+const G4TouchableHandle* G4PeriodicBoundaryProcess::FindLandingVolume(
+  G4int face, const G4ThreeVector& position, const G4ThreeVector& direction) const
+{
+
+  G4int f = 0;
+  while (!(face & (1 << f))) ++f;
+
+  if (current->full_relocation[f]) return NULL;
+
+  //the common case of a slab or layered cell, nothing sits at the face
+  if (current->landing_volumes[f].empty()) return &current->cell_touchable;
+
+  const G4AffineTransform& world_to_cell = current->cell.GetWorldToCell();
+  G4ThreeVector local_cell = world_to_cell.TransformPoint(position);
+  G4ThreeVector local_dir = world_to_cell.TransformAxis(direction);
+
+  for (auto& landing : current->landing_volumes[f]) {
+
+    G4ThreeVector local = landing.cell_to_local.TransformPoint(local_cell);
+    const G4VSolid* solid = landing.pv->GetLogicalVolume()->GetSolid();
+
+    EInside inside = solid->Inside(local);
+
+    if (inside == kInside) return &landing.touchable;
+
+    if (inside == kSurface) {
+      G4ThreeVector dir = landing.cell_to_local.TransformAxis(local_dir);
+      if (solid->SurfaceNormal(local) * dir < 0.) return &landing.touchable;
+    }
+  }
+
+  return &current->cell_touchable;
+
+}
+
+G4VPhysicalVolume* G4PeriodicBoundaryProcess::Relocate(G4int faces,
+  const G4ThreeVector& position, const G4ThreeVector& direction)
+{
+
+  //we must notify the navigator that we have moved the particle artificially
+  //the landing index only covers crossings of a single face
+  const G4TouchableHandle* landing =
+    (current->has_cell && G4PeriodicCell::CountFaces(faces) == 1) ?
+    FindLandingVolume(faces, position, direction) : NULL;
+
+  G4VPhysicalVolume* located = NULL;
+
+  if (landing) {
+    //restart the search from the volume known to contain the new position,
+    //rather than from the top of the geometry
+    located = navigator->ResetHierarchyAndLocate(position, direction,
+      *static_cast<G4TouchableHistory*>((*landing)()));
+  } else {
+    //Locates the volume containing the specified global point.
+    navigator->SetGeometricallyLimitedStep() ;
+    located = navigator->LocateGlobalPointAndSetup( position,
+                                                     &direction,
+                                                     true,
+                                                     false) ;//do not ignore direction
+  }
+
+  //the cached touchable is shared when the particle stays in the landing
+  //volume, otherwise the navigator creates one for the located volume
+  if (landing && located == (*landing)->GetVolume())
+    fParticleChange.ProposeTouchableHandle(*landing);
+  else
+    fParticleChange.ProposeTouchableHandle(navigator->CreateTouchableHistory());
+
+  return located;
+
+}
+
+void G4PeriodicBoundaryProcess::EnterOpticalInterface(const G4Step& step,
+  G4int faces, const G4ThreeVector& position, const G4ThreeVector& direction,
+  const G4VPhysicalVolume* located)
+{
+
+  /*a photon landing in the material it left is at no optical interface, and
+  G4OpBoundaryProcess leaves it without asking for a normal*/
+  if (!located || located->GetLogicalVolume()->GetMaterial() ==
+      step.GetPreStepPoint()->GetMaterial())
+    return;
+
+  /*otherwise the navigator must have entered the cell through the faces, as
+  transportation leaves it when a photon enters a volume. the photon is
+  stepped in from a point just outside every face it landed on, back along
+  its direction*/
+  G4double cosine = 1.;
+  for (G4int face = fFaceMinusX; face <= fFacePlusW; face <<= 1)
+    if (faces & face)
+      cosine = std::min(cosine,
+        -direction * OutwardNormal(G4PeriodicCell::GetOppositeFace(face)));
+
+  if (cosine <= 0.) return;
+
+  const G4double entry_distance = 1000*kCarTolerance;
+  G4double back = entry_distance / cosine;
+  G4ThreeVector outside = position - back * direction;
+
+  navigator->LocateGlobalPointAndSetup(outside, &direction, false, false);
+
+  G4double safety;
+  G4double step_length = navigator->ComputeStep(outside, direction, 2*back,
+    safety);
+
+  //a step entering elsewhere, as at an edge of the cell, keeps the relocated
+  //touchable, and the photon is located there again
+  if (std::fabs(step_length - back) > entry_distance) {
+    Relocate(faces, position, direction);
+    return;
+  }
+
+  navigator->SetGeometricallyLimitedStep();
+  navigator->LocateGlobalPointAndSetup(position, &direction, true, false);
+
+  fParticleChange.ProposeTouchableHandle(navigator->CreateTouchableHistory());
+
+}
+
+G4VParticleChange*
+G4PeriodicBoundaryProcess::PostStepDoIt(const G4Track& aTrack, const G4Step& aStep)
+{
+  //the generic process decides at run time, see G4TPeriodicBoundaryProcess
+  if (reflecting_walls)
+    return CrossBoundary<kAllFaces, fReflectingBoundary, kVerbose>(aTrack, aStep);
+
+  return CrossBoundary<kAllFaces, fCyclicBoundary, kVerbose>(aTrack, aStep);
+}
+
+G4VParticleChange* G4PeriodicBoundaryProcess::CrossPeriodicFace(
+  const G4Track& aTrack, const G4Step& aStep, const G4VTouchable* entered)
+{
+  if (reflecting_walls)
+    return CrossPeriodicFaces<kAllFaces, fReflectingBoundary, kVerbose>(aTrack, aStep,
+      entered);
+
+  return CrossPeriodicFaces<kAllFaces, fCyclicBoundary, kVerbose>(aTrack, aStep,
+    entered);
+}
+
+G4int G4PeriodicBoundaryProcess::LeavingFaces(G4int faces,
+  const G4ThreeVector& momentum) const
+{
+  G4int leaving = current->cell.LeavingFaces(faces, momentum);
+
+  //a direction tangent to every face gives no preference, keep them all
+  return leaving ? leaving : faces;
+}
+
+G4int G4PeriodicBoundaryProcess::GetNavigatorFace(const G4ThreeVector& point,
+  const G4ThreeVector& momentum) const
+{
+  //the navigator normal points into the cell
+  G4ThreeVector theGlobalNormal = GetNavigatorNormal(point, momentum);
+
+  if (current->has_cell) {
+    const G4PeriodicCell& cell = current->cell;
+    for (G4int face = fFaceMinusX; face <= fFacePlusW; face <<= 1)
+      if (cell.GetNumberOfFacePairs() > G4PeriodicCell::GetPair(face) &&
+          (-theGlobalNormal).isNear(cell.GetOutwardNormal(face), 1e-9))
+        return face;
+    return fNoFace;
+  }
+
+  for (G4int axis = 0; axis < 3; ++axis) {
+    G4ThreeVector unit;
+    unit[axis] = 1.;
+    if (theGlobalNormal.isParallel(unit))
+      return (theGlobalNormal[axis] < 0.) ? (fFacePlusX << (2*axis))
+                                          : (fFaceMinusX << (2*axis));
+  }
+
+  return fNoFace;
+}
+
+G4ThreeVector G4PeriodicBoundaryProcess::OutwardNormal(G4int face) const
+{
+  if (current->has_cell) return current->cell.GetOutwardNormal(face);
+
+  G4ThreeVector normal;
+  normal[G4PeriodicCell::GetPair(face)] =
+    G4PeriodicCell::IsPlusFace(face) ? 1. : -1.;
+  return normal;
+}
+
+G4ThreeVector G4PeriodicBoundaryProcess::CycleThrough(
+  const G4ThreeVector& position, G4int face) const
+{
+  if (current->has_cell) return current->cell.CycleThrough(position, face);
+
+  //without a cell the periodic world volume is assumed centred at the origin
+  G4ThreeVector image = position;
+  G4int axis = G4PeriodicCell::GetPair(face);
+  image[axis] = -image[axis];
+  return image;
+}
+
+G4double G4PeriodicBoundaryProcess::GetRecoveryDistance(
+  const G4Track& track) const
+{
+  if (!field_propagator || track.GetDynamicParticle()->GetCharge() == 0.)
+    return recovery_distance;
+
+  /*a step of a charged track in a field ends where the intersection locator
+  has put the crossing of its curved path with the boundary, which is only
+  within the delta intersection of the face. the field manager is the one
+  the propagator used for the step*/
+  G4FieldManager* field_manager = field_propagator->GetCurrentFieldManager();
+
+  if (!field_manager || !field_manager->DoesFieldExist())
+    return recovery_distance;
+
+  return std::max(recovery_distance, field_manager->GetDeltaIntersection());
+}
+
+void G4PeriodicBoundaryProcess::ApplyCrossingBudget(const G4Track& track)
+{
+  if (crossing_budget <= 0) return;
+
+  if (++track_crossings < crossing_budget) return;
+
+  track_crossings = 0;
+
+  /*a survivor of the roulette carries the weight of the tracks killed with
+  it, so that tallies are unbiased, and is given a further budget. the number
+  of crossings of a track is thus bounded in expectation by the budget over
+  the probability of being killed*/
+  if (budget_policy == fBudgetRoulette) {
+    statistics.CountRoulette();
+    if (G4UniformRand() < survival_probability) {
+      fParticleChange.ProposeWeight(track.GetWeight()/survival_probability);
+      return;
+    }
+  }
+
+  fParticleChange.ProposeLocalEnergyDeposit(track.GetKineticEnergy());
+  fParticleChange.ProposeTrackStatus(fStopAndKill);
+
+  statistics.CountBudgetKill(track.GetWeight()*track.GetKineticEnergy());
+
+  if (verboseLevel > 0)
+    G4cout << " Track " << track.GetTrackID() << " killed after using up its"
+      << " crossing budget" << G4endl;
+}
+
+void G4PeriodicBoundaryProcess::DumpBudgetStatistics() const
+{
+  if (crossing_budget <= 0) return;
+
+  G4cout << "Periodic crossing budget of " << crossing_budget << " crossings, ";
+  if (budget_policy == fBudgetRoulette)
+    G4cout << "Russian roulette with survival probability "
+      << survival_probability << G4endl
+      << "  roulettes: " << statistics.GetRoulettes() << G4endl;
+  else
+    G4cout << "tracks killed" << G4endl;
+  G4cout << "  killed tracks: " << statistics.GetBudgetKills() << G4endl
+    << "  killed energy: " << statistics.GetBudgetEnergy()/MeV << " MeV" << G4endl;
+}
+
+void G4PeriodicBoundaryProcess::RecordTrajectory(const G4Track& track,
+  const G4Step& step)
+{
+  //force drawing of the step prior to cycling the particle
+  if (trajectory_mode == fTrajectoryAppend) {
+    trajectory->AppendStep(&step);
+    return;
+  }
+
+  //the point appended at the end of the step is the first in the new image
+  G4PeriodicImageInformation* info = G4PeriodicImageInformation::Get(&track);
+  if (info) info->AddWrapMarker(trajectory->GetPointEntries());
+}
+
+void G4PeriodicBoundaryProcess::CountInterval(const G4Track& track)
+{
+  statistics.AddInterval(track.GetCurrentStepNumber() - last_crossing_step,
+    track.GetTrackLength() - last_crossing_length);
+
+  last_crossing_step = track.GetCurrentStepNumber();
+  last_crossing_length = track.GetTrackLength();
+}
+
+void G4PeriodicBoundaryProcess::CountImage(const G4Track& track, G4int face,
+  const G4ThreeVector& displacement)
+{
+  G4PeriodicImageInformation* info = G4PeriodicImageInformation::Attach(&track);
+
+  //without a cell the pairs of faces are those of the axes
+  G4int axis_shift[3] = {0, 0, 0};
+  axis_shift[G4PeriodicCell::GetPair(face)] = 1;
+
+  const G4int* shift = current->has_cell ? current->cell.GetImageShift(face)
+    : axis_shift;
+
+  G4int sign = G4PeriodicCell::IsPlusFace(face) ? 1 : -1;
+
+  //a wedge turns the point about its axis, which the turn back undoes
+  if (current->has_cell && current->cell.IsRotational()) {
+    G4RotationMatrix back = current->cell.GetFaceRotation(face).inverse();
+    G4ThreeVector axis_point = current->cell.GetCellToWorld().NetTranslation();
+    info->AddCrossing(shift, sign, back, axis_point - back * axis_point);
+    return;
+  }
+
+  info->AddCrossing(shift, sign, displacement);
+}
+
+void G4PeriodicBoundaryProcess::PassImageToSecondaries(
+  const G4TrackVector* secondaries)
+{
+  if (!secondaries || !current_track) return;
+
+  const G4PeriodicImageInformation* info =
+    G4PeriodicImageInformation::Get(current_track);
+
+  //secondaries are appended to the vector for the whole track, so each one
+  //is passed the image once, when it is current
+  for (; inherited_secondaries < secondaries->size(); ++inherited_secondaries) {
+    if (!info) continue;
+    G4PeriodicImageInformation::Attach((*secondaries)[inherited_secondaries],
+      *info);
+  }
+}
+
+void G4PeriodicBoundaryProcess::StartTracking(G4Track* track)
+{
+  G4VDiscreteProcess::StartTracking(track);
+  track_crossings = 0;
+  last_crossing_step = 0;
+  last_crossing_length = 0.;
+  current_track = track;
+  inherited_secondaries = 0;
+  parallel_relocation = false;
+
+  //the trajectory, if any, is created before the processes start tracking
+  trajectory = NULL;
+  if (trajectory_mode != fTrajectoryOff) {
+    G4EventManager* event_manager = G4EventManager::GetEventManager();
+    if (event_manager)
+      trajectory = event_manager->GetTrackingManager()->GimmeTrajectory();
+  }
+}
+
+void G4PeriodicBoundaryProcess::EndTracking()
+{
+  //the secondaries created since the last crossing are in the final image
+  if (current_track) PassImageToSecondaries(current_track->GetStep()->GetSecondary());
+
+  current_track = NULL;
+  trajectory = NULL;
+  parallel_relocation = false;
+  G4VDiscreteProcess::EndTracking();
+}
+
+void G4PeriodicBoundaryProcess::RelocateParallelWorlds(const G4Track& track)
+{
+  if (!parallel_relocation) return;
+  parallel_relocation = false;
+
+  std::map<const G4ParticleDefinition*,
+    std::vector<G4ParallelWorldProcess*> >::const_iterator found =
+    parallel_worlds.find(track.GetDefinition());
+
+  if (found == parallel_worlds.end()) return;
+
+  /*a parallel world process left alone would go on trusting the safety it
+  found on the far side of the cell, and its navigator would still be in the
+  volume the track left. its state is only reached through the public
+  interface, so each process starts tracking again from where the track now
+  is, which has the path finder locate every active navigator and resets the
+  ghost touchables and safety. the process reads the track without changing
+  it*/
+  G4Track* moved = const_cast<G4Track*>(&track);
+
+  for (auto process : found->second) process->StartTracking(moved);
+}
+
+G4double G4PeriodicBoundaryProcess::PostStepGetPhysicalInteractionLength(
+  const G4Track& aTrack, G4double, G4ForceCondition* condition)
+{
+
+  *condition = Forced;
+
+  //the track has been moved since it was cycled
+  RelocateParallelWorlds(aTrack);
+
+  const G4VPhysicalVolume* pv = aTrack.GetVolume();
+
+  //volumes created after the cache was built are always forced
+  if (geometry_cached && pv) {
+    size_t id = pv->GetInstanceID();
+    if (id < volume_flags.size() && !(volume_flags[id] & kForcedFrom))
+      *condition = NotForced;
+  }
+
+  return DBL_MAX;
+
+}
+
+G4ThreeVector G4PeriodicBoundaryProcess::GetNavigatorNormal(
+  const G4ThreeVector& theGlobalPoint, const G4ThreeVector& momentum) const
+{
+
+  // calculation of the global normal. code adapted from G4OpBoundaryProcess
+
+  G4bool valid;
+  //  Use the new method for Exit Normal in global coordinates,
+  //    which provides the normal more reliably.
+  G4ThreeVector normal = navigator->GetGlobalExitNormal(theGlobalPoint,&valid);
+
+  if (valid) {
+    normal = -normal;
+  }
+  else if (current) {
+    //the normal of the periodic volume itself stands in for it
+    const G4AffineTransform& to_world = current->to_world;
+    G4ThreeVector local = to_world.Inverse().TransformPoint(theGlobalPoint);
+    normal = -to_world.TransformAxis(
+      current->lv->GetSolid()->SurfaceNormal(local));
+    statistics.CountRecovery();
+  }
+  else {
+    G4cout << "global normal " << normal << G4endl;
+    G4ExceptionDescription ed;
+    ed << " G4PeriodicBoundaryProcess/PostStepDoIt(): "
+      << " The Navigator reports that it returned an invalid normal" << G4endl;
+    G4Exception("G4PeriodicBoundaryProcess::PostStepDoIt", "PerBoun01",
+      EventMustBeAborted,ed,
+      "Invalid Surface Normal - Geometry must return valid surface normal");
+    statistics.CountAbortedEvent();
+  }
+
+  if (momentum * normal > 0.0) {
+
+    statistics.CountNormalFlip();
+
+    if ( verboseLevel > 0 ) {
+
+      G4cout << "theGlobalNormal points in a wrong direction." << G4endl;
+      G4cout << "Invalid Surface Normal - Geometry must return valid surface \
+        normal pointing in the right direction" << G4endl;
+
+    }
+
+    normal = -normal;
+  }
+
+  return normal;
 
 }
 
@@ -274,4 +1141,6 @@ void G4PeriodicBoundaryProcess::BoundaryProcessVerbose() const
                 G4cout << " *** periodic *** " << G4endl;
         if ( theStatus == StepTooSmall )
                 G4cout << " *** StepTooSmall *** " << G4endl;
+        if ( theStatus == LeftArray )
+                G4cout << " *** LeftArray *** " << G4endl;
 }
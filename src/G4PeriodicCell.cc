@@ -0,0 +1,631 @@
+#include "G4PeriodicCell.hh"
+
+#include "G4Box.hh"
+#include "G4Para.hh"
+#include "G4Polycone.hh"
+#include "G4Polyhedra.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Tubs.hh"
+
+#include <algorithm>
+
+G4PeriodicCell::G4PeriodicCell()
+{
+  shape = fBoxCell;
+  npairs = 0;
+  pair_mask = 0;
+  half_angle = 0.;
+  tolerance = 0.;
+  wedge_solid = NULL;
+}
+
+G4PeriodicCell::G4PeriodicCell(const G4ThreeVector& half,
+  const G4AffineTransform& to_world, G4double tol)
+{
+  shape = fBoxCell;
+  npairs = 0;
+  pair_mask = 0;
+  half_angle = 0.;
+  cell_to_world = to_world;
+  world_to_cell = to_world.Inverse();
+  tolerance = tol;
+  wedge_solid = NULL;
+
+  lattice[0] = G4ThreeVector(2*half.x(), 0, 0);
+  lattice[1] = G4ThreeVector(0, 2*half.y(), 0);
+  lattice[2] = G4ThreeVector(0, 0, 2*half.z());
+
+  AddFacePair(0, G4ThreeVector(1, 0, 0), 1, 0, 0);
+  AddFacePair(1, G4ThreeVector(0, 1, 0), 0, 1, 0);
+  AddFacePair(2, G4ThreeVector(0, 0, 1), 0, 0, 1);
+}
+
+G4PeriodicCell::G4PeriodicCell(const G4ThreeVector& a, const G4ThreeVector& b,
+  const G4ThreeVector& c, const G4AffineTransform& to_world, G4double tol)
+{
+  shape = fTriclinicCell;
+  npairs = 0;
+  pair_mask = 0;
+  half_angle = 0.;
+  cell_to_world = to_world;
+  world_to_cell = to_world.Inverse();
+  tolerance = tol;
+  wedge_solid = NULL;
+
+  lattice[0] = a;
+  lattice[1] = b;
+  lattice[2] = c;
+
+  //the faces of a lattice vector are spanned by the other two
+  AddFacePair(0, b.cross(c), 1, 0, 0);
+  AddFacePair(1, c.cross(a), 0, 1, 0);
+  AddFacePair(2, a.cross(b), 0, 0, 1);
+}
+
+G4PeriodicCell::G4PeriodicCell(G4double apothem, G4double half_z,
+  G4double phi_start, const G4AffineTransform& to_world, G4double tol)
+{
+  shape = fHexagonalCell;
+  npairs = 0;
+  pair_mask = 0;
+  half_angle = 0.;
+  cell_to_world = to_world;
+  world_to_cell = to_world.Inverse();
+  tolerance = tol;
+  wedge_solid = NULL;
+
+  //the side normals of a polyhedra lie half way across each side
+  G4double phi = phi_start + 30*deg;
+
+  G4ThreeVector n0(std::cos(phi), std::sin(phi), 0);
+  G4ThreeVector n1(std::cos(phi + 60*deg), std::sin(phi + 60*deg), 0);
+
+  lattice[0] = 2*apothem*n0;
+  lattice[1] = 2*apothem*n1;
+  lattice[2] = G4ThreeVector(0, 0, 2*half_z);
+
+  //the third pair of sides joins the images at b - a
+  AddFacePair(0, n0, 1, 0, 0);
+  AddFacePair(1, n1, 0, 1, 0);
+  AddFacePair(2, G4ThreeVector(0, 0, 1), 0, 0, 1);
+  AddFacePair(3, n1 - n0, -1, 1, 0);
+}
+
+G4PeriodicCell::G4PeriodicCell(G4double half, const G4AffineTransform& to_world,
+  G4double tol)
+{
+  shape = fWedgeCell;
+  npairs = 0;
+  pair_mask = 0;
+  cell_to_world = to_world;
+  world_to_cell = to_world.Inverse();
+  tolerance = tol;
+  wedge_solid = NULL;
+  half_angle = half;
+
+  //the chord between the directions of the faces stands for the lattice, so
+  //that wedges of the same angle compare equal
+  lattice[0] = G4ThreeVector(0, 2*std::sin(half), 0);
+  lattice[1] = lattice[2] = G4ThreeVector();
+
+  //the translation of the pair is unused, crossing it rotates the point
+  FacePair& face_pair = pairs[0];
+  face_pair.normal = G4ThreeVector(0, 1, 0);
+  face_pair.distance = 0.;
+  face_pair.shift[0] = 1;
+  face_pair.shift[1] = face_pair.shift[2] = 0;
+
+  pair_mask = 1;
+  npairs = 1;
+}
+
+G4PeriodicCell::~G4PeriodicCell()
+{
+}
+
+G4bool G4PeriodicCell::Build(const G4VSolid* solid,
+  const G4AffineTransform& to_world, G4double tol,
+  G4AffineTransform& volume_to_cell)
+{
+
+  //the cell frame is that of the volume, unless the solid is off centre
+  volume_to_cell = G4AffineTransform();
+
+  const G4Box* box = dynamic_cast<const G4Box*>(solid);
+
+  if (box) {
+    *this = G4PeriodicCell(G4ThreeVector(box->GetXHalfLength(),
+      box->GetYHalfLength(), box->GetZHalfLength()), to_world, tol);
+    return true;
+  }
+
+  const G4Para* para = dynamic_cast<const G4Para*>(solid);
+
+  if (para) {
+    //the edges of a parallelepiped centred at its origin
+    G4ThreeVector axis = para->GetSymAxis();
+    G4ThreeVector a(2*para->GetXHalfLength(), 0, 0);
+    G4ThreeVector b(2*para->GetYHalfLength()*para->GetTanAlpha(),
+      2*para->GetYHalfLength(), 0);
+    G4ThreeVector c = (2*para->GetZHalfLength()/axis.z()) * axis;
+    *this = G4PeriodicCell(a, b, c, to_world, tol);
+    return true;
+  }
+
+  const G4Polyhedra* hex = dynamic_cast<const G4Polyhedra*>(solid);
+
+  if (hex && hex->GetNumSide() == 6 && !hex->IsOpen()) {
+
+    //only a solid prism, all outer corners at one radius and no inner radius
+    G4double rmax = 0;
+    G4double zmin = kInfinity;
+    G4double zmax = -kInfinity;
+
+    for (G4int i = 0; i < hex->GetNumRZCorner(); ++i) {
+      G4PolyhedraSideRZ corner = hex->GetCorner(i);
+      rmax = std::max(rmax, corner.r);
+      zmin = std::min(zmin, corner.z);
+      zmax = std::max(zmax, corner.z);
+    }
+
+    for (G4int i = 0; i < hex->GetNumRZCorner(); ++i) {
+      G4PolyhedraSideRZ corner = hex->GetCorner(i);
+      if (corner.r > tol && std::fabs(corner.r - rmax) > tol)
+        return false;
+    }
+
+    //the corners are at the vertices, the sides at the apothem
+    G4double apothem = rmax * std::cos(30*deg);
+
+    G4ThreeVector centre(0, 0, 0.5*(zmin + zmax));
+    volume_to_cell = G4AffineTransform(-centre);
+
+    *this = G4PeriodicCell(apothem, 0.5*(zmax - zmin), hex->GetStartPhi(),
+      G4AffineTransform(centre) * to_world, tol);
+    return true;
+  }
+
+  //a wedge of a tube or a polycone, periodic in phi
+  G4double start_phi = 0.;
+  G4double delta_phi = 0.;
+
+  const G4Tubs* tubs = dynamic_cast<const G4Tubs*>(solid);
+  const G4Polycone* polycone = dynamic_cast<const G4Polycone*>(solid);
+
+  if (tubs) {
+    start_phi = tubs->GetStartPhiAngle();
+    delta_phi = tubs->GetDeltaPhiAngle();
+  } else if (polycone) {
+    start_phi = polycone->GetStartPhi();
+    delta_phi = polycone->GetEndPhi() - polycone->GetStartPhi();
+  }
+
+  if ((tubs || polycone) && delta_phi < twopi - 1e-9 && delta_phi > 0.) {
+
+    //the cell frame is turned so that its x axis bisects the wedge
+    G4RotationMatrix frame;
+    frame.rotateZ(-(start_phi + 0.5*delta_phi));
+    G4AffineTransform cell_to_volume(frame, G4ThreeVector());
+    volume_to_cell = cell_to_volume.Inverse();
+
+    *this = G4PeriodicCell(0.5*delta_phi, cell_to_volume * to_world, tol);
+    wedge_solid = solid;
+    world_to_solid = to_world.Inverse();
+    return true;
+  }
+
+  return false;
+
+}
+
+void G4PeriodicCell::AddFacePair(G4int pair, const G4ThreeVector& normal,
+  G4int shift_a, G4int shift_b, G4int shift_c)
+{
+  FacePair& face_pair = pairs[pair];
+
+  face_pair.shift[0] = shift_a;
+  face_pair.shift[1] = shift_b;
+  face_pair.shift[2] = shift_c;
+
+  face_pair.translation = shift_a*lattice[0] + shift_b*lattice[1]
+    + shift_c*lattice[2];
+
+  //the plus face is the one the translation points through
+  face_pair.normal = normal.unit();
+  if (face_pair.normal * face_pair.translation < 0.)
+    face_pair.normal = -face_pair.normal;
+
+  face_pair.distance = 0.5 * (face_pair.normal * face_pair.translation);
+
+  pair_mask |= (1 << pair);
+  npairs++;
+}
+
+G4ThreeVector G4PeriodicCell::WedgeNormal(G4int face) const
+{
+  G4double s = std::sin(half_angle);
+  G4double c = std::cos(half_angle);
+  return IsPlusFace(face) ? G4ThreeVector(-s, c, 0) : G4ThreeVector(-s, -c, 0);
+}
+
+G4ThreeVector G4PeriodicCell::WedgeDirection(G4int face) const
+{
+  G4double s = std::sin(half_angle);
+  G4double c = std::cos(half_angle);
+  return IsPlusFace(face) ? G4ThreeVector(c, s, 0) : G4ThreeVector(c, -s, 0);
+}
+
+G4int G4PeriodicCell::LocateWedgeFaces(const G4ThreeVector& local) const
+{
+  G4int mask = fNoFace;
+
+  //on the half plane of a face, not on its extension beyond the axis
+  for (G4int face = fFaceMinusX; face <= fFacePlusX; face <<= 1) {
+    if (std::fabs(WedgeNormal(face) * local) <= tolerance
+      && WedgeDirection(face) * local >= -tolerance)
+      mask |= face;
+  }
+
+  return mask;
+}
+
+G4bool G4PeriodicCell::OnOpenSurface(const G4ThreeVector& global_point) const
+{
+  if (!wedge_solid) return false;
+
+  return wedge_solid->Inside(world_to_solid.TransformPoint(global_point))
+    == kSurface;
+}
+
+G4int G4PeriodicCell::LeavingFaces(G4int faces,
+  const G4ThreeVector& global_direction) const
+{
+  G4int leaving = fNoFace;
+
+  for (G4int bits = faces; bits; bits &= bits - 1) {
+    G4int face = bits & -bits;
+    if (global_direction * GetOutwardNormal(face) > 0.) leaving |= face;
+  }
+
+  return leaving;
+}
+
+G4int G4PeriodicCell::RecoverFaces(const G4ThreeVector& global_point,
+  const G4ThreeVector& global_direction, G4double recovery,
+  G4ThreeVector& on_faces) const
+{
+  G4ThreeVector local = world_to_cell.TransformPoint(global_point);
+  G4ThreeVector dir = world_to_cell.TransformAxis(global_direction);
+
+  G4int near = fNoFace;
+  G4int leaving = fNoFace;
+
+  if (shape == fWedgeCell) {
+
+    G4ThreeVector projected[2];
+
+    for (G4int face = fFaceMinusX; face <= fFacePlusX; face <<= 1) {
+      G4ThreeVector normal = WedgeNormal(face);
+      G4double height = normal * local;
+      projected[face - 1] = local - height * normal;
+      if (std::fabs(height) > recovery
+        || WedgeDirection(face) * projected[face - 1] < -recovery)
+        continue;
+      near |= face;
+      if (normal * dir > 0.) leaving |= face;
+    }
+
+    G4int faces = leaving ? leaving : near;
+
+    //near the axis both planes are within reach, the point is kept on it
+    if (faces == (fFaceMinusX | fFacePlusX))
+      on_faces = cell_to_world.TransformPoint(G4ThreeVector(0, 0, local.z()));
+    else if (faces)
+      on_faces = cell_to_world.TransformPoint(projected[faces - 1]);
+
+    return faces;
+  }
+
+  G4double deviation[kMaxFacePairs];
+
+  for (G4int i = 0; i < kMaxFacePairs; ++i) {
+
+    deviation[i] = 0.;
+
+    if (!(pair_mask & (1 << i))) continue;
+
+    G4double height = pairs[i].normal * local;
+    G4double speed = pairs[i].normal * dir;
+
+    G4int face = fNoFace;
+    if (std::fabs(height - pairs[i].distance) <= recovery) {
+      face = fFacePlusX << (2*i);
+      deviation[i] = height - pairs[i].distance;
+      if (speed > 0.) leaving |= face;
+    } else if (std::fabs(height + pairs[i].distance) <= recovery) {
+      face = fFaceMinusX << (2*i);
+      deviation[i] = height + pairs[i].distance;
+      if (speed < 0.) leaving |= face;
+    }
+
+    near |= face;
+  }
+
+  G4int faces = leaving ? leaving : near;
+
+  //the point is moved onto the plane of each face along its normal
+  for (G4int i = 0; i < kMaxFacePairs; ++i)
+    if (faces & ((fFaceMinusX | fFacePlusX) << (2*i)))
+      local -= deviation[i] * pairs[i].normal;
+
+  on_faces = cell_to_world.TransformPoint(local);
+
+  return faces;
+}
+
+G4int G4PeriodicCell::FacesReached(const G4ThreeVector& pmin,
+  const G4ThreeVector& pmax) const
+{
+  G4int mask = fNoFace;
+
+  //a box reaches a plane of a wedge if any corner is on or beyond it
+  if (shape == fWedgeCell) {
+    for (G4int face = fFaceMinusX; face <= fFacePlusX; face <<= 1)
+      for (G4int c = 0; c < 8; ++c) {
+        G4ThreeVector corner((c & 1) ? pmax.x() : pmin.x(),
+                             (c & 2) ? pmax.y() : pmin.y(),
+                             (c & 4) ? pmax.z() : pmin.z());
+        if (WedgeNormal(face) * corner >= -tolerance) mask |= face;
+      }
+    return mask;
+  }
+
+  for (G4int i = 0; i < kMaxFacePairs; ++i) {
+
+    if (!(pair_mask & (1 << i))) continue;
+
+    G4double hmin = kInfinity;
+    G4double hmax = -kInfinity;
+
+    for (G4int c = 0; c < 8; ++c) {
+      G4ThreeVector corner((c & 1) ? pmax.x() : pmin.x(),
+                           (c & 2) ? pmax.y() : pmin.y(),
+                           (c & 4) ? pmax.z() : pmin.z());
+      G4double height = pairs[i].normal * corner;
+      hmin = std::min(hmin, height);
+      hmax = std::max(hmax, height);
+    }
+
+    if (hmax >= pairs[i].distance - tolerance) mask |= (fFacePlusX << (2*i));
+    if (hmin <= -pairs[i].distance + tolerance) mask |= (fFaceMinusX << (2*i));
+  }
+
+  return mask;
+}
+
+G4ThreeVector G4PeriodicCell::GetOutwardNormal(G4int face) const
+{
+  if (shape == fWedgeCell) return cell_to_world.TransformAxis(WedgeNormal(face));
+
+  const FacePair& face_pair = pairs[GetPair(face)];
+
+  G4ThreeVector normal = IsPlusFace(face) ? face_pair.normal : -face_pair.normal;
+
+  return cell_to_world.TransformAxis(normal);
+}
+
+G4ThreeVector G4PeriodicCell::CycleThrough(const G4ThreeVector& global_point,
+  G4int face) const
+{
+  G4ThreeVector local = world_to_cell.TransformPoint(global_point);
+
+  //the plus plane is turned onto the minus plane, and back
+  if (shape == fWedgeCell) {
+    local.rotateZ(IsPlusFace(face) ? -2*half_angle : 2*half_angle);
+    return cell_to_world.TransformPoint(local);
+  }
+
+  const FacePair& face_pair = pairs[GetPair(face)];
+
+  if (IsPlusFace(face)) local -= face_pair.translation;
+  else local += face_pair.translation;
+
+  return cell_to_world.TransformPoint(local);
+}
+
+G4ThreeVector G4PeriodicCell::RotateThrough(const G4ThreeVector& global_vector,
+  G4int face) const
+{
+  if (shape != fWedgeCell) return global_vector;
+
+  G4ThreeVector local = world_to_cell.TransformAxis(global_vector);
+  local.rotateZ(IsPlusFace(face) ? -2*half_angle : 2*half_angle);
+
+  return cell_to_world.TransformAxis(local);
+}
+
+G4RotationMatrix G4PeriodicCell::GetFaceRotation(G4int face) const
+{
+  return G4RotationMatrix(RotateThrough(G4ThreeVector(1, 0, 0), face),
+    RotateThrough(G4ThreeVector(0, 1, 0), face),
+    RotateThrough(G4ThreeVector(0, 0, 1), face));
+}
+
+G4ThreeVector G4PeriodicCell::Wrap(const G4ThreeVector& global_point,
+  const G4ThreeVector* global_direction, G4int mask,
+  G4ThreeVector& displacement) const
+{
+  G4ThreeVector start = world_to_cell.TransformPoint(global_point);
+  G4ThreeVector local = start;
+
+  G4ThreeVector dir;
+  if (global_direction) dir = world_to_cell.TransformAxis(*global_direction);
+
+  //a wedge is folded by turning the point into the sector of the cell
+  if (shape == fWedgeCell) {
+
+    G4double images = 0;
+
+    if (mask & (fFaceMinusX | fFacePlusX)) {
+      G4int on_faces = LocateWedgeFaces(local);
+      if (global_direction && (on_faces & fFacePlusX) && WedgeNormal(fFacePlusX) * dir > 0.)
+        images = 1;
+      else if (global_direction && (on_faces & fFaceMinusX) && WedgeNormal(fFaceMinusX) * dir > 0.)
+        images = -1;
+      else if (!on_faces)
+        images = std::floor(0.5*(local.phi() + half_angle)/half_angle);
+    }
+
+    local.rotateZ(-2*half_angle*images);
+
+    //only the move of the point is told, the turn is not
+    displacement = cell_to_world.TransformAxis(start - local);
+
+    return cell_to_world.TransformPoint(local);
+  }
+
+  /*the pairs of a box or a parallelepiped are independent and are folded in
+  one pass, the sides of a hexagon take a few passes from a distant point*/
+  for (G4int pass = 0; pass < 2*kMaxFacePairs; ++pass) {
+
+    G4bool moved = false;
+
+    for (G4int i = 0; i < kMaxFacePairs; ++i) {
+
+      if (!(pair_mask & (1 << i))) continue;
+      if (!(mask & ((fFaceMinusX | fFacePlusX) << (2*i)))) continue;
+
+      const FacePair& face_pair = pairs[i];
+
+      G4double height = face_pair.normal * local;
+      G4double distance = face_pair.distance;
+
+      G4double images = 0;
+
+      if (height > distance + tolerance || height < -distance - tolerance)
+        images = std::floor(0.5*(height + distance)/distance);
+      else if (global_direction && std::fabs(height - distance) <= tolerance
+        && face_pair.normal * dir > 0.)
+        images = 1;
+      else if (global_direction && std::fabs(height + distance) <= tolerance
+        && face_pair.normal * dir < 0.)
+        images = -1;
+
+      if (images != 0) {
+        local -= images * face_pair.translation;
+        moved = true;
+      }
+    }
+
+    if (!moved) break;
+  }
+
+  displacement = cell_to_world.TransformAxis(start - local);
+
+  return cell_to_world.TransformPoint(local);
+}
+
+G4double G4PeriodicCell::DistanceToFaces(const G4ThreeVector& global_point,
+  const G4ThreeVector& global_direction, G4int mask, G4int& faces) const
+{
+  G4ThreeVector local = world_to_cell.TransformPoint(global_point);
+  G4ThreeVector dir = world_to_cell.TransformAxis(global_direction);
+
+  G4double nearest = kInfinity;
+
+  if (shape == fWedgeCell) {
+    faces = fNoFace;
+    if (!(mask & (fFaceMinusX | fFacePlusX))) return nearest;
+
+    G4double to_face[2] = {kInfinity, kInfinity};
+
+    //the planes of a wedge are left where the direction points out of them
+    for (G4int face = fFaceMinusX; face <= fFacePlusX; face <<= 1) {
+      G4ThreeVector normal = WedgeNormal(face);
+      G4double speed = normal * dir;
+      if (speed > 0.) to_face[face - 1] = std::max(0., -(normal * local)/speed);
+      nearest = std::min(nearest, to_face[face - 1]);
+    }
+
+    for (G4int face = fFaceMinusX; face <= fFacePlusX; face <<= 1)
+      if (to_face[face - 1] < kInfinity && to_face[face - 1] <= nearest + tolerance)
+        faces |= face;
+
+    return nearest;
+  }
+
+  G4double distances[kMaxFacePairs];
+  G4int reached[kMaxFacePairs];
+
+  for (G4int i = 0; i < kMaxFacePairs; ++i) {
+
+    distances[i] = kInfinity;
+    reached[i] = fNoFace;
+
+    if (!(pair_mask & (1 << i))) continue;
+    if (!(mask & ((fFaceMinusX | fFacePlusX) << (2*i)))) continue;
+
+    const FacePair& face_pair = pairs[i];
+
+    G4double height = face_pair.normal * local;
+    G4double speed = face_pair.normal * dir;
+
+    if (speed > 0.) {
+      distances[i] = std::max(0., (face_pair.distance - height)/speed);
+      reached[i] = fFacePlusX << (2*i);
+    } else if (speed < 0.) {
+      distances[i] = std::max(0., (-face_pair.distance - height)/speed);
+      reached[i] = fFaceMinusX << (2*i);
+    }
+
+    nearest = std::min(nearest, distances[i]);
+  }
+
+  //an edge or a corner is reached through every face within the tolerance
+  faces = fNoFace;
+  for (G4int i = 0; i < kMaxFacePairs; ++i)
+    if (distances[i] <= nearest + tolerance) faces |= reached[i];
+
+  return nearest;
+}
+
+G4double G4PeriodicCell::SafetyToFace(const G4ThreeVector& global_point,
+  G4int face) const
+{
+  G4ThreeVector local = world_to_cell.TransformPoint(global_point);
+
+  if (shape == fWedgeCell) return -(WedgeNormal(face) * local);
+
+  const FacePair& face_pair = pairs[GetPair(face)];
+  G4double height = face_pair.normal * local;
+
+  return IsPlusFace(face) ? face_pair.distance - height
+    : face_pair.distance + height;
+}
+
+G4int G4PeriodicCell::GetPeriodicMask(G4bool per_a, G4bool per_b,
+  G4bool per_c) const
+{
+  G4bool periodic[3] = {per_a, per_b, per_c};
+
+  G4int mask = fNoFace;
+
+  for (G4int i = 0; i < kMaxFacePairs; ++i) {
+
+    if (!(pair_mask & (1 << i))) continue;
+
+    G4bool pair_periodic = true;
+    for (G4int k = 0; k < 3; ++k)
+      if (pairs[i].shift[k] && !periodic[k]) pair_periodic = false;
+
+    if (pair_periodic) mask |= ((fFaceMinusX | fFacePlusX) << (2*i));
+  }
+
+  return mask;
+}
+
+const G4int* G4PeriodicCell::GetImageShift(G4int face) const
+{
+  return pairs[GetPair(face)].shift;
+}
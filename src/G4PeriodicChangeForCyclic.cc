@@ -1,13 +1,21 @@
 #include "G4DynamicParticle.hh"
 #include "G4ExceptionSeverity.hh"
+#include "G4LogicalVolume.hh"
 #include "G4ParticleChangeForPeriodic.hh"
 #include "G4Step.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4Track.hh"
+#include "G4VPhysicalVolume.hh"
 
 
 G4ParticleChangeForPeriodic::G4ParticleChangeForPeriodic() : G4VParticleChange() {
 
+  currentTrack = NULL;
+  proposedMaterial = NULL;
+  proposedMaterialCutsCouple = NULL;
+  proposedSensitiveDetector = NULL;
+  isTouchableProposed = false;
+
 }
 
 G4ParticleChangeForPeriodic::~G4ParticleChangeForPeriodic(){}
@@ -22,6 +30,11 @@ G4ParticleChangeForPeriodic::G4ParticleChangeForPeriodic(
   proposedMomentumDirection = right.proposedMomentumDirection;
   proposedPolarization = right.proposedPolarization;
   proposedPosition = right.proposedPosition;
+  proposedTouchableHandle = right.proposedTouchableHandle;
+  proposedMaterial = right.proposedMaterial;
+  proposedMaterialCutsCouple = right.proposedMaterialCutsCouple;
+  proposedSensitiveDetector = right.proposedSensitiveDetector;
+  isTouchableProposed = right.isTouchableProposed;
 }
 
 
@@ -58,6 +71,11 @@ G4ParticleChangeForPeriodic & G4ParticleChangeForPeriodic::operator=(
     proposedMomentumDirection = right.proposedMomentumDirection;
     proposedPolarization = right.proposedPolarization;
     proposedPosition = right.proposedPosition;
+    proposedTouchableHandle = right.proposedTouchableHandle;
+    proposedMaterial = right.proposedMaterial;
+    proposedMaterialCutsCouple = right.proposedMaterialCutsCouple;
+    proposedSensitiveDetector = right.proposedSensitiveDetector;
+    isTouchableProposed = right.isTouchableProposed;
   }
   return *this;
 }
@@ -71,6 +89,13 @@ G4Step* G4ParticleChangeForPeriodic::UpdateStepForPostStep(G4Step* pStep)
   pPostStepPoint->SetPolarization( proposedPolarization );
   pPostStepPoint->SetPosition( proposedPosition );
 
+  if (isTouchableProposed) {
+    pPostStepPoint->SetTouchableHandle( proposedTouchableHandle );
+    pPostStepPoint->SetMaterial( (G4Material*) proposedMaterial );
+    pPostStepPoint->SetMaterialCutsCouple( proposedMaterialCutsCouple );
+    pPostStepPoint->SetSensitiveDetector( proposedSensitiveDetector );
+  }
+
   if (isParentWeightProposed ){
     pPostStepPoint->SetWeight( theParentWeight );
   }
@@ -81,6 +106,27 @@ G4Step* G4ParticleChangeForPeriodic::UpdateStepForPostStep(G4Step* pStep)
   return pStep;
 }
 
+void G4ParticleChangeForPeriodic::ProposeTouchableHandle(
+  const G4TouchableHandle& touchable)
+{
+  proposedTouchableHandle = touchable;
+
+  G4VPhysicalVolume* pv = touchable->GetVolume();
+
+  proposedMaterial = NULL;
+  proposedMaterialCutsCouple = NULL;
+  proposedSensitiveDetector = NULL;
+
+  if (pv) {
+    G4LogicalVolume* lv = pv->GetLogicalVolume();
+    proposedMaterial = lv->GetMaterial();
+    proposedMaterialCutsCouple = lv->GetMaterialCutsCouple();
+    proposedSensitiveDetector = lv->GetSensitiveDetector();
+  }
+
+  isTouchableProposed = true;
+}
+
 void G4ParticleChangeForPeriodic::AddSecondary(G4DynamicParticle* aParticle)
 {
   G4Track* aTrack = new G4Track(aParticle, currentTrack->GetGlobalTime(),
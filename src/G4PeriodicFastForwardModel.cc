@@ -0,0 +1,260 @@
+#include "G4PeriodicFastForwardModel.hh"
+#include "G4PeriodicImageInformation.hh"
+
+#include "G4FastStep.hh"
+#include "G4FastTrack.hh"
+#include "G4GeometryTolerance.hh"
+#include "G4LogicalVolume.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4ProcessManager.hh"
+#include "G4ProcessVector.hh"
+#include "G4Track.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+
+#include <algorithm>
+
+G4PeriodicFastForwardModel::G4PeriodicFastForwardModel(const G4String& name,
+  G4Region* envelope, G4bool per_x, G4bool per_y, G4bool per_z)
+  : G4VFastSimulationModel(name, envelope)
+{
+  periodic_x = per_x; periodic_y = per_y; periodic_z = per_z;
+
+  minimum_crossings = 2;
+  maximum_crossings = 100000;
+
+  envelope_pv = NULL;
+  has_cell = false;
+  periodic_mask = fNoFace;
+  tolerance = G4GeometryTolerance::GetInstance()->GetSurfaceTolerance();
+
+  declined_track = NULL;
+
+  last_track = NULL;
+  last_track_id = 0;
+  last_step_number = 0;
+  last_track_length = 0.;
+  previous_step = 0.;
+
+  number_of_crossings = 0;
+  number_of_fast_steps = 0;
+}
+
+G4PeriodicFastForwardModel::~G4PeriodicFastForwardModel()
+{
+}
+
+G4bool G4PeriodicFastForwardModel::IsApplicable(
+  const G4ParticleDefinition& particle)
+{
+  return particle.GetPDGCharge() == 0. &&
+    &particle != G4OpticalPhoton::OpticalPhotonDefinition();
+}
+
+void G4PeriodicFastForwardModel::CacheCell(const G4FastTrack& fast_track)
+{
+  envelope_pv = fast_track.GetEnvelopePhysicalVolume();
+  to_envelope = *fast_track.GetAffineTransformation();
+
+  G4AffineTransform volume_to_cell;
+  has_cell = cell.Build(fast_track.GetEnvelopeSolid(),
+    *fast_track.GetInverseAffineTransformation(), tolerance, volume_to_cell);
+
+  //the straight line through a wedge is turned at each face, it is tracked
+  //by the boundary process
+  if (has_cell && cell.IsRotational()) has_cell = false;
+
+  periodic_mask = has_cell ?
+    cell.GetPeriodicMask(periodic_x, periodic_y, periodic_z) : fNoFace;
+
+  if (!has_cell) {
+    G4ExceptionDescription ed;
+    ed << " The envelope " << envelope_pv->GetName() << " is not a periodic"
+      << " box, parallelepiped or hexagonal prism, the model " << GetName()
+      << " is never triggered" << G4endl;
+    G4Exception("G4PeriodicFastForwardModel::CacheCell", "Periodic09",
+      JustWarning, ed);
+  }
+}
+
+G4double G4PeriodicFastForwardModel::DistanceToDaughters(
+  const G4ThreeVector& point, const G4ThreeVector& direction,
+  G4double limit) const
+{
+  G4LogicalVolume* lv = envelope_pv->GetLogicalVolume();
+
+  G4double nearest = limit;
+
+  for (size_t i = 0; i < lv->GetNoDaughters(); ++i) {
+    G4VPhysicalVolume* daughter = lv->GetDaughter(i);
+    G4AffineTransform to_daughter = G4AffineTransform(daughter->GetRotation(),
+      daughter->GetTranslation()).Inverse();
+    G4double distance = daughter->GetLogicalVolume()->GetSolid()->DistanceToIn(
+      to_daughter.TransformPoint(point), to_daughter.TransformAxis(direction));
+    nearest = std::min(nearest, distance);
+  }
+
+  return nearest;
+}
+
+G4int G4PeriodicFastForwardModel::Advance(G4ThreeVector& point,
+  const G4ThreeVector& direction, G4double limit, G4int max_crossings,
+  G4double& travelled, const G4Track* track)
+{
+  const G4VSolid* solid = envelope_pv->GetLogicalVolume()->GetSolid();
+
+  G4int crossings = 0;
+  travelled = 0.;
+
+  while (crossings < max_crossings) {
+
+    G4int faces;
+    G4double to_face = cell.DistanceToFaces(point, direction, periodic_mask,
+      faces);
+
+    if (travelled + to_face >= limit) break;
+
+    //the line must reach the periodic face inside the envelope, missing the
+    //daughters and the faces that are not periodic
+    G4ThreeVector local = to_envelope.TransformPoint(point);
+    G4ThreeVector local_dir = to_envelope.TransformAxis(direction);
+
+    if (solid->DistanceToOut(local, local_dir) < to_face - tolerance) break;
+    if (DistanceToDaughters(local, local_dir, to_face) < to_face) break;
+
+    G4ThreeVector displacement;
+    point = cell.Wrap(point + to_face*direction, &direction, periodic_mask,
+      displacement);
+
+    travelled += to_face;
+    crossings++;
+
+    if (!track) continue;
+
+    G4PeriodicImageInformation* info = G4PeriodicImageInformation::Attach(track);
+
+    //an edge or a corner moves the track through each of its faces, the
+    //displacement is that of all of them
+    for (G4int face = fFaceMinusX; face <= fFacePlusW; face <<= 1) {
+      if (!(faces & face)) continue;
+      info->AddCrossing(cell.GetImageShift(face),
+        G4PeriodicCell::IsPlusFace(face) ? 1 : -1, displacement);
+      displacement = G4ThreeVector();
+    }
+  }
+
+  return crossings;
+}
+
+G4double G4PeriodicFastForwardModel::InteractionDistance(const G4Track& track,
+  G4double previous_step) const
+{
+  G4ProcessManager* manager = track.GetDefinition()->GetProcessManager();
+  G4ProcessVector* processes = manager->GetPostStepProcessVector(typeGPIL);
+
+  G4double distance = kInfinity;
+
+  for (G4int i = 0; i < (G4int)processes->size(); ++i) {
+
+    G4VProcess* process = (*processes)[i];
+
+    if (!process) continue;
+
+    //only the processes that hold a number of interaction lengths, not the
+    //boundary process, parallel worlds, step limiters or fast simulation
+    switch (process->GetProcessType()) {
+      case fElectromagnetic:
+      case fHadronic:
+      case fPhotolepton_hadron:
+      case fDecay:
+        break;
+      default:
+        continue;
+    }
+
+    /*the fast simulation process comes first, and has kept the stepping
+    manager from asking the processes for this step. they are asked here as
+    it would have, so that they take off the previous step and return the
+    distance to the interaction they already hold*/
+    G4ForceCondition condition = NotForced;
+    G4double length = process->PostStepGPIL(track, previous_step, &condition);
+
+    if (condition == NotForced) distance = std::min(distance, length);
+  }
+
+  return distance;
+}
+
+G4bool G4PeriodicFastForwardModel::ModelTrigger(const G4FastTrack& fast_track)
+{
+  const G4Track* track = fast_track.GetPrimaryTrack();
+
+  if (fast_track.GetEnvelopePhysicalVolume() != envelope_pv)
+    CacheCell(fast_track);
+
+  //only from the periodic world volume itself, not from its daughters
+  if (!has_cell || track->GetVolume() != envelope_pv) return false;
+
+  /*the processes are only up to date with the track if they were asked for
+  its last step, which the model must have seen. a track entering the volume
+  takes a step before it may be fast forwarded*/
+  G4bool seen = (track == last_track && track->GetTrackID() == last_track_id
+    && track->GetCurrentStepNumber() == last_step_number + 1);
+
+  previous_step = seen ? track->GetTrackLength() - last_track_length : 0.;
+
+  last_track = track;
+  last_track_id = track->GetTrackID();
+  last_step_number = track->GetCurrentStepNumber();
+  last_track_length = track->GetTrackLength();
+
+  if (!seen) return false;
+
+  if (track == declined_track && track->GetPosition() == declined_position)
+    return false;
+
+  G4ThreeVector point = track->GetPosition();
+  G4double travelled;
+
+  return Advance(point, track->GetMomentumDirection(), kInfinity,
+    minimum_crossings, travelled, NULL) == minimum_crossings;
+}
+
+void G4PeriodicFastForwardModel::DoIt(const G4FastTrack& fast_track,
+  G4FastStep& fast_step)
+{
+  const G4Track* track = fast_track.GetPrimaryTrack();
+
+  G4double distance = InteractionDistance(*track, previous_step);
+
+  G4ThreeVector point = track->GetPosition();
+  G4double travelled;
+
+  G4int crossings = Advance(point, track->GetMomentumDirection(), distance,
+    maximum_crossings, travelled, track);
+
+  /*the particle interacts before it reaches a face. it is left where it is
+  and tracked normally, the processes keep the interaction lengths they hold*/
+  if (crossings == 0) {
+    declined_track = track;
+    declined_position = track->GetPosition();
+    fast_step.ProposePrimaryTrackPathLength(0.);
+    return;
+  }
+
+  const G4DynamicParticle* particle = track->GetDynamicParticle();
+
+  fast_step.ProposePrimaryTrackFinalPosition(point, false);
+  fast_step.ProposePrimaryTrackPathLength(travelled);
+  fast_step.ProposePrimaryTrackFinalTime(track->GetGlobalTime()
+    + travelled/track->GetVelocity());
+
+  if (particle->GetMass() > 0.)
+    fast_step.ProposePrimaryTrackFinalProperTime(track->GetProperTime()
+      + travelled*particle->GetMass()/(particle->GetTotalMomentum()*c_light));
+
+  number_of_crossings += crossings;
+  number_of_fast_steps++;
+}
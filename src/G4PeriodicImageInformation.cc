@@ -0,0 +1,173 @@
+#include "G4PeriodicImageInformation.hh"
+
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include "G4ios.hh"
+
+G4PeriodicImageInformation::G4PeriodicImageInformation(
+  G4VUserTrackInformation* info) : G4VUserTrackInformation()
+{
+  image[0] = image[1] = image[2] = 0;
+  user_information = info;
+}
+
+G4PeriodicImageInformation::G4PeriodicImageInformation(
+  const G4PeriodicImageInformation& right) : G4VUserTrackInformation()
+{
+  for (G4int i = 0; i < 3; ++i) image[i] = right.image[i];
+  offset = right.offset;
+  rotation = right.rotation;
+  user_information = NULL;
+}
+
+G4PeriodicImageInformation::~G4PeriodicImageInformation()
+{
+  delete user_information;
+}
+
+void G4PeriodicImageInformation::Print() const
+{
+  G4cout << " periodic image (" << image[0] << ", " << image[1] << ", "
+    << image[2] << ") offset " << offset;
+  if (!rotation.isIdentity())
+    G4cout << " rotation " << rotation.delta() / deg << " deg about "
+      << rotation.axis();
+  G4cout << G4endl;
+  if (user_information) user_information->Print();
+}
+
+void G4PeriodicImageInformation::AddCrossing(const G4int* shift, G4int sign,
+  const G4ThreeVector& displacement)
+{
+  for (G4int i = 0; i < 3; ++i) image[i] += sign * shift[i];
+  offset += rotation * displacement;
+}
+
+void G4PeriodicImageInformation::AddCrossing(const G4int* shift, G4int sign,
+  const G4RotationMatrix& turn, const G4ThreeVector& translation)
+{
+  for (G4int i = 0; i < 3; ++i) image[i] += sign * shift[i];
+  offset += rotation * translation;
+  rotation = rotation * turn;
+}
+
+void G4PeriodicImageInformation::AddOffset(const G4ThreeVector& displacement)
+{
+  offset += rotation * displacement;
+}
+
+void G4PeriodicImageInformation::Reset()
+{
+  image[0] = image[1] = image[2] = 0;
+  offset = G4ThreeVector();
+  rotation = G4RotationMatrix();
+}
+
+void G4PeriodicImageInformation::AddWrapMarker(G4int point)
+{
+  WrapMarker marker;
+  marker.point = point;
+  marker.offset = offset;
+  marker.rotation = rotation;
+  wrap_markers.push_back(marker);
+}
+
+const G4PeriodicImageInformation::WrapMarker*
+G4PeriodicImageInformation::FindMarker(G4int point) const
+{
+  //the markers are in the order of the points, the last one not beyond the
+  //point holds its image
+  const WrapMarker* marker = NULL;
+
+  for (size_t i = 0; i < wrap_markers.size(); ++i) {
+    if (wrap_markers[i].point > point) break;
+    marker = &wrap_markers[i];
+  }
+
+  return marker;
+}
+
+G4ThreeVector G4PeriodicImageInformation::GetPointOffset(G4int point) const
+{
+  const WrapMarker* marker = FindMarker(point);
+  return marker ? marker->offset : G4ThreeVector();
+}
+
+G4ThreeVector G4PeriodicImageInformation::UnwrapPoint(G4int point,
+  const G4ThreeVector& position) const
+{
+  const WrapMarker* marker = FindMarker(point);
+  return marker ? marker->rotation * position + marker->offset : position;
+}
+
+G4PeriodicImageInformation* G4PeriodicImageInformation::Get(const G4Track* track)
+{
+  //the user information may be any other, or none
+  return dynamic_cast<G4PeriodicImageInformation*>(track->GetUserInformation());
+}
+
+G4PeriodicImageInformation* G4PeriodicImageInformation::Attach(
+  const G4Track* track)
+{
+  G4PeriodicImageInformation* info = Get(track);
+
+  if (!info) {
+    info = new G4PeriodicImageInformation(track->GetUserInformation());
+    track->SetUserInformation(info);
+  }
+
+  return info;
+}
+
+void G4PeriodicImageInformation::Attach(const G4Track* track,
+  const G4PeriodicImageInformation& parent)
+{
+  G4PeriodicImageInformation* info = new G4PeriodicImageInformation(parent);
+  G4PeriodicImageInformation* previous = Get(track);
+
+  //the user information of the secondary is kept, any image it held is not
+  if (previous) {
+    info->user_information = previous->user_information;
+    previous->user_information = NULL;
+    delete previous;
+  } else {
+    info->user_information = track->GetUserInformation();
+  }
+
+  track->SetUserInformation(info);
+}
+
+G4VUserTrackInformation* G4PeriodicImageInformation::GetUserInformation(
+  const G4Track* track)
+{
+  G4PeriodicImageInformation* info = Get(track);
+  return info ? info->user_information : track->GetUserInformation();
+}
+
+void G4PeriodicImageInformation::SetUserInformation(const G4Track* track,
+  G4VUserTrackInformation* user_information)
+{
+  G4PeriodicImageInformation* info = Get(track);
+  if (info) info->user_information = user_information;
+  else track->SetUserInformation(user_information);
+}
+
+G4ThreeVector G4PeriodicImageInformation::GetUnwrappedPosition(
+  const G4Track* track)
+{
+  return Unwrap(track, track->GetPosition());
+}
+
+G4ThreeVector G4PeriodicImageInformation::Unwrap(const G4Track* track,
+  const G4ThreeVector& point)
+{
+  const G4PeriodicImageInformation* info = Get(track);
+  return info ? info->rotation * point + info->offset : point;
+}
+
+G4ThreeVector G4PeriodicImageInformation::UnwrapDirection(const G4Track* track,
+  const G4ThreeVector& direction)
+{
+  const G4PeriodicImageInformation* info = Get(track);
+  return info ? info->rotation * direction : direction;
+}
@@ -0,0 +1,386 @@
+#include "G4PeriodicNavigator.hh"
+
+#include "G4GeometryTolerance.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumePeriodic.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+
+namespace {
+
+//the periodic faces crossed within a single step before it is ended anyway
+const G4int kMaxCrossingsPerStep = 100000;
+
+//marks the calls made from within an overridden method, whose points are
+//already in the cell frame, for the duration of a scope
+class CellFrameScope {
+public:
+  CellFrameScope(G4bool& flag) : in_cell_frame(flag) { in_cell_frame = true; }
+  ~CellFrameScope() { in_cell_frame = false; }
+private:
+  G4bool& in_cell_frame;
+};
+
+}
+
+G4PeriodicNavigator::G4PeriodicNavigator(G4bool per_x, G4bool per_y,
+  G4bool per_z) : G4Navigator()
+{
+  periodic_x = per_x; periodic_y = per_y; periodic_z = per_z;
+
+  cell_world = NULL;
+  has_cell = false;
+  periodic_mask = fNoFace;
+
+  cell_pv = NULL;
+  wrapped_safety = false;
+  can_wrap = false;
+
+  current_pv = NULL;
+  probe = new G4Navigator();
+
+  tolerance = G4GeometryTolerance::GetInstance()->GetSurfaceTolerance();
+
+  in_cell_frame = false;
+  number_of_crossings = 0;
+}
+
+G4PeriodicNavigator::~G4PeriodicNavigator()
+{
+  delete probe;
+}
+
+void G4PeriodicNavigator::CacheCell()
+{
+  G4VPhysicalVolume* world = GetWorldVolume();
+
+  cell_world = world;
+  has_cell = false;
+  cell_pv = NULL;
+  can_wrap = false;
+  offset = step_offset = G4ThreeVector();
+
+  if (!world) return;
+
+  probe->SetWorldVolume(world);
+
+  G4LogicalVolume* lworld = world->GetLogicalVolume();
+
+  for (size_t i = 0; i < lworld->GetNoDaughters(); ++i) {
+
+    G4VPhysicalVolume* daughter = lworld->GetDaughter(i);
+
+    if (!dynamic_cast<G4LogicalVolumePeriodic*>(daughter->GetLogicalVolume()))
+      continue;
+
+    G4AffineTransform volume_to_cell;
+    G4AffineTransform to_world(daughter->GetRotation(), daughter->GetTranslation());
+    has_cell = cell.Build(daughter->GetLogicalVolume()->GetSolid(), to_world,
+      tolerance, volume_to_cell);
+
+    //the unfolded space of a wedge is not a lattice of translations
+    if (has_cell && cell.IsRotational()) has_cell = false;
+
+    cell_pv = daughter;
+    world_to_volume = to_world.Inverse();
+
+    G4LogicalVolume* lcell = daughter->GetLogicalVolume();
+    can_wrap = true;
+    for (size_t j = 0; j < lcell->GetNoDaughters(); ++j)
+      if (lcell->GetDaughter(j)->IsReplicated()) can_wrap = false;
+    break;
+  }
+
+  if (has_cell) {
+    periodic_mask = cell.GetPeriodicMask(periodic_x, periodic_y, periodic_z);
+  } else {
+    G4ExceptionDescription ed;
+    ed << " No periodic box, parallelepiped or hexagonal prism was found in"
+      << " the world volume, the periodic navigator navigates the world as"
+      << " G4Navigator does" << G4endl;
+    G4Exception("G4PeriodicNavigator::CacheCell", "Periodic06", JustWarning, ed);
+  }
+}
+
+G4ThreeVector G4PeriodicNavigator::Wrap(const G4ThreeVector& point) const
+{
+  if (!has_cell) return point;
+
+  G4ThreeVector displacement;
+  return cell.Wrap(point, 0, periodic_mask, displacement);
+}
+
+G4bool G4PeriodicNavigator::IsSeamless(const G4ThreeVector& landing,
+  const G4ThreeVector& direction)
+{
+  //the copies of a replica are told apart by the navigation history only,
+  //so a crossing in a replicated volume is never continued
+  if (!current_pv || current_pv->IsReplicated()) return false;
+
+  return probe->LocateGlobalPointAndSetup(landing, &direction, false, false)
+    == current_pv;
+}
+
+G4double G4PeriodicNavigator::ComputeStep(const G4ThreeVector& point,
+  const G4ThreeVector& direction, const G4double proposed_step,
+  G4double& new_safety)
+{
+  if (in_cell_frame || !has_cell)
+    return G4Navigator::ComputeStep(point, direction, proposed_step, new_safety);
+
+  CellFrameScope scope(in_cell_frame);
+
+  //a point moved into another image since it was located, as the start of a
+  //chord in a field may be, is located again in the cell
+  G4ThreeVector displacement;
+  G4ThreeVector local = cell.Wrap(point - offset, &direction, periodic_mask,
+    displacement);
+
+  if (displacement.mag2() > 0.) {
+    offset += displacement;
+    current_pv = G4Navigator::LocateGlobalPointAndSetup(local, &direction,
+      false, false);
+  }
+
+  step_offset = offset;
+
+  G4double travelled = 0.;
+  G4double remaining = proposed_step;
+
+  for (G4int crossings = 0; ; ++crossings) {
+
+    G4double safety;
+    G4double step = G4Navigator::ComputeStep(local, direction, remaining, safety);
+
+    //the safety is that of the start point, which ignores the images beyond
+    //the faces unless it is wrapped
+    if (crossings == 0) new_safety = wrapped_safety ?
+      WrapSafety(local, safety, kInfinity) : safety;
+
+    G4int faces;
+    G4double to_face = cell.DistanceToFaces(local, direction, periodic_mask,
+      faces);
+
+    G4bool at_face = (to_face < remaining && to_face <= step + tolerance
+      && crossings < kMaxCrossingsPerStep);
+
+    //the step is limited by physics, which is signalled as G4Navigator does,
+    //or by a volume inside the cell
+    if (!at_face) {
+      if (step >= remaining) return (step > remaining) ? step : proposed_step;
+      return travelled + step;
+    }
+
+    //the step ends on a periodic face, it continues through the opposite face
+    //only if the particle stays in the same volume
+    G4ThreeVector landing = cell.Wrap(local + to_face*direction, &direction,
+      periodic_mask, displacement);
+
+    if (!IsSeamless(landing, direction)) return travelled + to_face;
+
+    current_pv = G4Navigator::LocateGlobalPointAndSetup(landing, &direction,
+      false, false);
+
+    step_offset += displacement;
+    local = landing;
+    travelled += to_face;
+    remaining -= to_face;
+
+    number_of_crossings += G4PeriodicCell::CountFaces(faces);
+  }
+}
+
+G4VPhysicalVolume* G4PeriodicNavigator::LocateGlobalPointAndSetup(
+  const G4ThreeVector& point, const G4ThreeVector* direction,
+  const G4bool pRelativeSearch, const G4bool ignoreDirection)
+{
+  if (in_cell_frame)
+    return G4Navigator::LocateGlobalPointAndSetup(point, direction,
+      pRelativeSearch, ignoreDirection);
+
+  if (GetWorldVolume() != cell_world) CacheCell();
+
+  if (!has_cell) {
+    current_pv = G4Navigator::LocateGlobalPointAndSetup(point, direction,
+      pRelativeSearch, ignoreDirection);
+    return current_pv;
+  }
+
+  CellFrameScope scope(in_cell_frame);
+
+  /*a search from the top, as for the first step of a track, finds the image
+  from the point alone. the image of the last track, which may have been
+  another one, does not apply*/
+  if (!pRelativeSearch) step_offset = G4ThreeVector();
+
+  //the end of a step is in the image reached by the step. a point beyond a
+  //periodic face, or on one and leaving it, is moved into the next image and
+  //located from the top, with its direction
+  G4ThreeVector displacement;
+  G4ThreeVector local = cell.Wrap(point - step_offset, direction, periodic_mask,
+    displacement);
+
+  G4bool relative = pRelativeSearch;
+  G4bool ignore = ignoreDirection;
+
+  if (displacement.mag2() > 0.) {
+    relative = false;
+    ignore = (direction == 0);
+  }
+
+  offset = step_offset = step_offset + displacement;
+
+  current_pv = G4Navigator::LocateGlobalPointAndSetup(local, direction, relative,
+    ignore);
+
+  return current_pv;
+}
+
+G4VPhysicalVolume* G4PeriodicNavigator::ResetHierarchyAndLocate(
+  const G4ThreeVector& point, const G4ThreeVector& direction,
+  const G4TouchableHistory& h)
+{
+  if (in_cell_frame)
+    return G4Navigator::ResetHierarchyAndLocate(point, direction, h);
+
+  if (GetWorldVolume() != cell_world) CacheCell();
+
+  if (!has_cell) {
+    current_pv = G4Navigator::ResetHierarchyAndLocate(point, direction, h);
+    return current_pv;
+  }
+
+  CellFrameScope scope(in_cell_frame);
+
+  //a track resumed with its touchable, as a secondary is, may start in any
+  //image, which is found from its point alone; the touchable is that of the
+  //cell
+  G4ThreeVector displacement;
+  G4ThreeVector local = cell.Wrap(point, &direction, periodic_mask,
+    displacement);
+
+  offset = step_offset = displacement;
+
+  current_pv = G4Navigator::ResetHierarchyAndLocate(local, direction, h);
+
+  return current_pv;
+}
+
+void G4PeriodicNavigator::LocateGlobalPointWithinVolume(
+  const G4ThreeVector& position)
+{
+  if (in_cell_frame || !has_cell) {
+    G4Navigator::LocateGlobalPointWithinVolume(position);
+    return;
+  }
+
+  CellFrameScope scope(in_cell_frame);
+
+  //a step that was not taken to its end may stop short of the image its
+  //computation reached, the volume is the same on either side
+  G4ThreeVector displacement;
+  G4ThreeVector local = cell.Wrap(position - step_offset, 0, periodic_mask,
+    displacement);
+
+  offset = step_offset = step_offset + displacement;
+
+  G4Navigator::LocateGlobalPointWithinVolume(local);
+}
+
+G4double G4PeriodicNavigator::ComputeSafety(const G4ThreeVector& point,
+  const G4double max_length, const G4bool keep_state)
+{
+  if (in_cell_frame || !has_cell)
+    return G4Navigator::ComputeSafety(point, max_length, keep_state);
+
+  CellFrameScope scope(in_cell_frame);
+
+  G4ThreeVector displacement;
+  G4ThreeVector local = cell.Wrap(point - step_offset, 0, periodic_mask,
+    displacement);
+
+  G4double safety = G4Navigator::ComputeSafety(local, max_length, keep_state);
+
+  return wrapped_safety ? WrapSafety(local, safety, max_length) : safety;
+}
+
+G4double G4PeriodicNavigator::WrapSafety(const G4ThreeVector& local,
+  G4double safety, G4double max_length) const
+{
+  //a point in a daughter keeps the safety of its volume
+  if (!can_wrap || fHistory.GetTopVolume() != cell_pv) return safety;
+
+  G4int nfaces = 2 * cell.GetNumberOfFacePairs();
+
+  G4double to_face[2 * G4PeriodicCell::kMaxFacePairs];
+  G4double to_periodic = kInfinity;
+  G4double bound = max_length;
+
+  for (G4int i = 0; i < nfaces; ++i) {
+    G4int face = fFaceMinusX << i;
+    to_face[i] = cell.SafetyToFace(local, face);
+    if (periodic_mask & face) to_periodic = std::min(to_periodic, to_face[i]);
+    else bound = std::min(bound, to_face[i]);
+  }
+
+  //a safety short of the periodic faces is limited by a daughter or by
+  //another face, which the images do not change
+  if (safety < to_periodic - tolerance || bound <= safety) return safety;
+
+  /*the safety sphere must stay within the cell and its neighbouring images,
+  the far faces of which lie two cell widths beyond the nearer face of each
+  periodic pair*/
+  for (G4int i = 0; i < nfaces; i += 2)
+    if (periodic_mask & (fFaceMinusX << i))
+      bound = std::min(bound, to_face[i] + to_face[i+1]
+        + std::min(to_face[i], to_face[i+1]));
+
+  bound = std::min(bound, DaughterSafety(local));
+
+  /*the daughters of an image across a set of faces, at most one of each
+  pair, are as far from the point as those of the cell are from its image
+  through the opposite faces*/
+  G4int near = fNoFace;
+  for (G4int i = 0; i < nfaces; ++i)
+    if ((periodic_mask & (fFaceMinusX << i)) && to_face[i] < bound)
+      near |= (fFaceMinusX << i);
+
+  for (G4int faces = near; faces; faces = (faces - 1) & near) {
+
+    G4bool both = false;
+    for (G4int i = 0; i < nfaces; i += 2)
+      if ((faces >> i & 3) == 3) both = true;
+    if (both) continue;
+
+    G4ThreeVector image = local;
+    for (G4int face = fFaceMinusX; face <= fFacePlusW; face <<= 1)
+      if (faces & face) image = cell.CycleThrough(image, face);
+
+    bound = std::min(bound, DaughterSafety(image));
+  }
+
+  return std::max(safety, bound);
+}
+
+G4double G4PeriodicNavigator::DaughterSafety(const G4ThreeVector& local) const
+{
+  G4ThreeVector point = world_to_volume.TransformPoint(local);
+
+  G4LogicalVolume* lcell = cell_pv->GetLogicalVolume();
+
+  G4double nearest = kInfinity;
+
+  for (size_t i = 0; i < lcell->GetNoDaughters(); ++i) {
+    const G4VPhysicalVolume* daughter = lcell->GetDaughter(i);
+    G4AffineTransform to_daughter(daughter->GetRotation(),
+      daughter->GetTranslation());
+    to_daughter.Invert();
+    nearest = std::min(nearest, daughter->GetLogicalVolume()->GetSolid()
+      ->DistanceToIn(to_daughter.TransformPoint(point)));
+  }
+
+  return nearest;
+}
@@ -0,0 +1,215 @@
+#include "G4PeriodicStatistics.hh"
+
+#include "G4AutoLock.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <vector>
+
+G4bool G4PeriodicStatistics::timing_enabled = false;
+
+namespace {
+
+G4Mutex registry_mutex = G4MUTEX_INITIALIZER;
+
+//the counters of every thread, for as long as their process exists
+std::vector<G4PeriodicStatistics*>& Registry()
+{
+  static std::vector<G4PeriodicStatistics*> registry;
+  return registry;
+}
+
+const char* kFaceNames[G4PeriodicStatistics::kFaces] =
+  {"-x", "+x", "-y", "+y", "-z", "+z", "-w", "+w"};
+
+const char* kPairNames[G4PeriodicCell::kMaxFacePairs] = {"x", "y", "z", "w"};
+
+G4int FaceIndex(G4int face)
+{
+  G4int index = 0;
+  while (face > 1) { face >>= 1; index++; }
+  return index;
+}
+
+void WriteArray(std::ostream& os, const G4long* values, G4int n)
+{
+  os << "[";
+  for (G4int i = 0; i < n; ++i) os << (i ? ", " : "") << values[i];
+  os << "]";
+}
+
+}
+
+G4PeriodicStatistics::G4PeriodicStatistics()
+{
+  Reset();
+
+  master = G4Threading::IsMasterThread();
+
+  G4AutoLock lock(&registry_mutex);
+  Registry().push_back(this);
+}
+
+G4PeriodicStatistics::~G4PeriodicStatistics()
+{
+  G4AutoLock lock(&registry_mutex);
+  std::vector<G4PeriodicStatistics*>& registry = Registry();
+  registry.erase(std::remove(registry.begin(), registry.end(), this),
+    registry.end());
+}
+
+void G4PeriodicStatistics::Reset()
+{
+  invocations = 0;
+  for (G4int i = 0; i < kFaces; ++i) crossings[i] = 0;
+  reflections = 0;
+  steps_too_small = 0;
+  normal_flips = 0;
+  recoveries = 0;
+  aborted_events = 0;
+  roulettes = 0;
+  budget_kills = 0;
+  budget_energy = 0.;
+  array_exits = 0;
+  array_kills = 0;
+  array_energy = 0.;
+
+  for (G4int i = 0; i < kBins; ++i) step_histogram[i] = length_histogram[i] = 0;
+
+  timed_invocations = 0;
+  time = 0.;
+}
+
+void G4PeriodicStatistics::CountCrossing(G4int face)
+{
+  crossings[FaceIndex(face)]++;
+}
+
+G4int G4PeriodicStatistics::Bin(G4double value)
+{
+  if (value < 1.) return 0;
+  G4int bin = 1 + (G4int)std::floor(std::log2(value));
+  return std::min(bin, (G4int)kBins - 1);
+}
+
+void G4PeriodicStatistics::AddInterval(G4int steps, G4double length)
+{
+  step_histogram[Bin(steps)]++;
+  length_histogram[Bin(length/micrometer)]++;
+}
+
+G4long G4PeriodicStatistics::GetCrossings(G4int face) const
+{
+  return crossings[FaceIndex(face)];
+}
+
+G4long G4PeriodicStatistics::GetPairCrossings(G4int pair) const
+{
+  return crossings[2*pair] + crossings[2*pair + 1];
+}
+
+void G4PeriodicStatistics::Add(const G4PeriodicStatistics& other)
+{
+  invocations += other.invocations;
+  for (G4int i = 0; i < kFaces; ++i) crossings[i] += other.crossings[i];
+  reflections += other.reflections;
+  steps_too_small += other.steps_too_small;
+  normal_flips += other.normal_flips;
+  recoveries += other.recoveries;
+  aborted_events += other.aborted_events;
+  roulettes += other.roulettes;
+  budget_kills += other.budget_kills;
+  budget_energy += other.budget_energy;
+  array_exits += other.array_exits;
+  array_kills += other.array_kills;
+  array_energy += other.array_energy;
+
+  for (G4int i = 0; i < kBins; ++i) {
+    step_histogram[i] += other.step_histogram[i];
+    length_histogram[i] += other.length_histogram[i];
+  }
+
+  timed_invocations += other.timed_invocations;
+  time += other.time;
+}
+
+void G4PeriodicStatistics::Merge(G4PeriodicStatistics& total)
+{
+  //the master only tracks in a sequential application
+  G4bool skip_master = G4Threading::IsMultithreadedApplication();
+
+  G4AutoLock lock(&registry_mutex);
+  for (auto statistics : Registry())
+    if (statistics != &total && !(skip_master && statistics->master))
+      total.Add(*statistics);
+}
+
+void G4PeriodicStatistics::ResetAll()
+{
+  G4AutoLock lock(&registry_mutex);
+  for (auto statistics : Registry()) statistics->Reset();
+}
+
+void G4PeriodicStatistics::Print(std::ostream& os) const
+{
+  os << "Periodic boundary statistics" << std::endl
+    << "  invocations:      " << invocations << std::endl
+    << "  crossings:       ";
+  for (G4int pair = 0; pair < G4PeriodicCell::kMaxFacePairs; ++pair)
+    os << " " << kPairNames[pair] << " " << GetPairCrossings(pair)
+      << " (" << crossings[2*pair] << " " << kFaceNames[2*pair] << ", "
+      << crossings[2*pair + 1] << " " << kFaceNames[2*pair + 1] << ")";
+  os << std::endl
+    << "  reflections:      " << reflections << std::endl
+    << "  StepTooSmall:     " << steps_too_small << std::endl
+    << "  normal flips:     " << normal_flips << std::endl
+    << "  recovered faces:  " << recoveries << std::endl
+    << "  aborted events:   " << aborted_events << std::endl
+    << "  roulettes:        " << roulettes << std::endl
+    << "  budget kills:     " << budget_kills << " ("
+      << budget_energy/MeV << " MeV)" << std::endl
+    << "  array exits:      " << array_exits << std::endl
+    << "  array kills:      " << array_kills << " ("
+      << array_energy/MeV << " MeV)" << std::endl;
+
+  if (timed_invocations > 0)
+    os << "  time in process:  " << time << " s, "
+      << time/timed_invocations*1e9 << " ns per invocation" << std::endl;
+
+  os << "  steps between crossings, from bin 0:";
+  for (G4int i = 0; i < kBins; ++i) os << " " << step_histogram[i];
+  os << std::endl << "  length between crossings [um], from bin 0:";
+  for (G4int i = 0; i < kBins; ++i) os << " " << length_histogram[i];
+  os << std::endl;
+}
+
+void G4PeriodicStatistics::Write(std::ostream& os) const
+{
+  os << "{" << std::endl
+    << "  \"invocations\": " << invocations << "," << std::endl
+    << "  \"crossings\": {";
+  for (G4int i = 0; i < kFaces; ++i)
+    os << (i ? ", " : "") << "\"" << kFaceNames[i] << "\": " << crossings[i];
+  os << "}," << std::endl
+    << "  \"reflections\": " << reflections << "," << std::endl
+    << "  \"step_too_small\": " << steps_too_small << "," << std::endl
+    << "  \"normal_flips\": " << normal_flips << "," << std::endl
+    << "  \"recoveries\": " << recoveries << "," << std::endl
+    << "  \"aborted_events\": " << aborted_events << "," << std::endl
+    << "  \"roulettes\": " << roulettes << "," << std::endl
+    << "  \"budget_kills\": " << budget_kills << "," << std::endl
+    << "  \"budget_energy_MeV\": " << budget_energy/MeV << "," << std::endl
+    << "  \"array_exits\": " << array_exits << "," << std::endl
+    << "  \"array_kills\": " << array_kills << "," << std::endl
+    << "  \"array_energy_MeV\": " << array_energy/MeV << "," << std::endl
+    << "  \"timed_invocations\": " << timed_invocations << "," << std::endl
+    << "  \"time_s\": " << time << "," << std::endl
+    << "  \"steps_between_crossings\": ";
+  WriteArray(os, step_histogram, kBins);
+  os << "," << std::endl << "  \"length_between_crossings_um\": ";
+  WriteArray(os, length_histogram, kBins);
+  os << std::endl << "}" << std::endl;
+}
@@ -0,0 +1,135 @@
+#include "G4PeriodicStatisticsMessenger.hh"
+#include "G4PeriodicStatistics.hh"
+
+#include "G4StateManager.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithoutParameter.hh"
+#include "G4UIdirectory.hh"
+#include "G4ios.hh"
+
+#include <fstream>
+
+G4PeriodicStatisticsMessenger::G4PeriodicStatisticsMessenger()
+{
+  pbc_directory = new G4UIdirectory("/pbc/");
+  pbc_directory->SetGuidance("Periodic boundary conditions.");
+
+  stats_directory = new G4UIdirectory("/pbc/stats/");
+  stats_directory->SetGuidance("Statistics of the periodic boundary process.");
+
+  print_command = new G4UIcmdWithoutParameter("/pbc/stats/print", this);
+  print_command->SetGuidance("Print the statistics merged over all threads.");
+  print_command->SetToBeBroadcasted(false);
+
+  dump_command = new G4UIcmdWithAString("/pbc/stats/dump", this);
+  dump_command->SetGuidance("Write the merged statistics to a file as JSON.");
+  dump_command->SetParameterName("file", false);
+  dump_command->SetToBeBroadcasted(false);
+
+  reset_command = new G4UIcmdWithoutParameter("/pbc/stats/reset", this);
+  reset_command->SetGuidance("Reset the statistics of every thread.");
+  reset_command->SetToBeBroadcasted(false);
+
+  timing_command = new G4UIcmdWithABool("/pbc/stats/timing", this);
+  timing_command->SetGuidance("Measure the time spent in the process.");
+  timing_command->SetParameterName("timing", true);
+  timing_command->SetDefaultValue(true);
+  timing_command->SetToBeBroadcasted(false);
+
+  print_at_end_command = new G4UIcmdWithABool("/pbc/stats/printAtEndOfRun",
+    this);
+  print_at_end_command->SetGuidance("Print the merged statistics after each run.");
+  print_at_end_command->SetParameterName("print", true);
+  print_at_end_command->SetDefaultValue(true);
+  print_at_end_command->SetToBeBroadcasted(false);
+
+  dump_at_end_command = new G4UIcmdWithAString("/pbc/stats/dumpAtEndOfRun",
+    this);
+  dump_at_end_command->SetGuidance("Write the merged statistics as JSON after each run.");
+  dump_at_end_command->SetGuidance("No file is written if it is empty.");
+  dump_at_end_command->SetParameterName("file", true);
+  dump_at_end_command->SetDefaultValue("");
+  dump_at_end_command->SetToBeBroadcasted(false);
+
+  print_at_end = true;
+}
+
+G4PeriodicStatisticsMessenger::~G4PeriodicStatisticsMessenger()
+{
+  delete dump_at_end_command;
+  delete print_at_end_command;
+  delete timing_command;
+  delete reset_command;
+  delete dump_command;
+  delete print_command;
+  delete stats_directory;
+  delete pbc_directory;
+}
+
+void G4PeriodicStatisticsMessenger::SetNewValue(G4UIcommand* command,
+  G4String value)
+{
+  if (command == timing_command) {
+    G4PeriodicStatistics::SetTiming(timing_command->GetNewBoolValue(value));
+    return;
+  }
+
+  if (command == reset_command) {
+    G4PeriodicStatistics::ResetAll();
+    return;
+  }
+
+  if (command == print_at_end_command) {
+    print_at_end = print_at_end_command->GetNewBoolValue(value);
+    return;
+  }
+
+  if (command == dump_at_end_command) {
+    dump_at_end = value;
+    return;
+  }
+
+  G4PeriodicStatistics total;
+  G4PeriodicStatistics::Merge(total);
+
+  if (command == print_command) {
+    total.Print(G4cout);
+    return;
+  }
+
+  Dump(value, total);
+}
+
+G4bool G4PeriodicStatisticsMessenger::Notify(G4ApplicationState requested_state)
+{
+  //the state manager has not left the state yet, a run ends from GeomClosed
+  if (requested_state != G4State_Idle || G4StateManager::GetStateManager()
+    ->GetCurrentState() != G4State_GeomClosed)
+    return true;
+
+  if (!print_at_end && dump_at_end.empty()) return true;
+
+  G4PeriodicStatistics total;
+  G4PeriodicStatistics::Merge(total);
+
+  if (print_at_end) total.Print(G4cout);
+  if (!dump_at_end.empty()) Dump(dump_at_end, total);
+
+  return true;
+}
+
+void G4PeriodicStatisticsMessenger::Dump(const G4String& file_name,
+  const G4PeriodicStatistics& total) const
+{
+  std::ofstream file(file_name);
+  if (!file) {
+    G4ExceptionDescription ed;
+    ed << " Cannot open " << file_name << " for the periodic boundary statistics"
+      << G4endl;
+    G4Exception("G4PeriodicStatisticsMessenger::Dump", "Periodic10",
+      JustWarning, ed);
+    return;
+  }
+  total.Write(file);
+}
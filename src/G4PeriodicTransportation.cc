@@ -0,0 +1,99 @@
+#include "G4PeriodicTransportation.hh"
+#include "G4PeriodicBoundaryProcess.hh"
+
+#include "G4ParticleChangeForPeriodic.hh"
+#include "G4ParticleChangeForTransport.hh"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4ios.hh"
+
+G4PeriodicTransportation::G4PeriodicTransportation(
+  G4PeriodicBoundaryProcess* process, G4int verbosity)
+  : G4Transportation(verbosity), boundary(process)
+{
+}
+
+G4PeriodicTransportation::~G4PeriodicTransportation()
+{
+}
+
+void G4PeriodicTransportation::PreparePhysicsTable(
+  const G4ParticleDefinition& particle)
+{
+  G4Transportation::PreparePhysicsTable(particle);
+  boundary->PreparePhysicsTable(particle);
+}
+
+void G4PeriodicTransportation::BuildPhysicsTable(
+  const G4ParticleDefinition& particle)
+{
+  G4Transportation::BuildPhysicsTable(particle);
+  boundary->BuildPhysicsTable(particle);
+}
+
+G4double G4PeriodicTransportation::PostStepGetPhysicalInteractionLength(
+  const G4Track& track, G4double previousStepSize, G4ForceCondition* pForceCond)
+{
+  //invoked before the along step lengths, which the parallel worlds limit
+  boundary->RelocateParallelWorlds(track);
+
+  return G4Transportation::PostStepGetPhysicalInteractionLength(track,
+    previousStepSize, pForceCond);
+}
+
+G4VParticleChange* G4PeriodicTransportation::PostStepDoIt(const G4Track& aTrack,
+  const G4Step& aStep)
+{
+  G4VParticleChange* change = G4Transportation::PostStepDoIt(aTrack, aStep);
+
+  if (aStep.GetPostStepPoint()->GetStepStatus() != fGeomBoundary)
+    return change;
+
+  /*transportation has located the particle in the volume it enters; only
+  entering the mother of a periodic volume is a periodic crossing*/
+  const G4TouchableHandle& touchable =
+    static_cast<G4ParticleChangeForTransport*>(change)->GetTouchableHandle();
+
+  const G4VPhysicalVolume* pv = touchable ? touchable->GetVolume() : 0;
+
+  if (!pv || !boundary->IsPeriodicMother(pv)) return change;
+
+  G4VParticleChange* crossing = boundary->CrossPeriodicFace(aTrack, aStep,
+    touchable());
+
+  G4PeriodicBoundaryProcessStatus status = boundary->GetStatus();
+
+  if (verboseLevel > 1)
+    G4cout << " G4PeriodicTransportation: periodic crossing status " << status
+      << G4endl;
+
+  //the particle change is only filled for a crossing of a periodic face
+  if (status != Cycling && status != Reflection && status != LeftArray)
+    return change;
+
+  /*the change of transportation cannot move the particle after the step, so
+  that of the boundary process is returned. transportation goes on from the
+  touchable it holds, which is put where the particle has been moved, as is
+  the touchable of its own change*/
+  G4ParticleChangeForPeriodic* moved =
+    static_cast<G4ParticleChangeForPeriodic*>(crossing);
+
+  if (moved->IsTouchableProposed()) {
+    fCurrentTouchableHandle = moved->GetProposedTouchableHandle();
+    SetTouchableInformation(fCurrentTouchableHandle);
+  }
+
+  return crossing;
+}
+
+void G4PeriodicTransportation::StartTracking(G4Track* aTrack)
+{
+  G4Transportation::StartTracking(aTrack);
+  boundary->StartTracking(aTrack);
+}
+
+void G4PeriodicTransportation::EndTracking()
+{
+  G4Transportation::EndTracking();
+  boundary->EndTracking();
+}
@@ -2,6 +2,7 @@
 import numpy as np
 import matplotlib.pyplot as plt
 import tables
+import glob
 from scipy import stats
 import sys
 
@@ -17,9 +18,14 @@ class Analysis:
     #
     def __init__(self):
         self.particle_name = "geantino"
-        self.number_modes = 4
+        self.number_modes = 9
         self.labels = ['semi-infinite world', 'finite world',
-            'finite world (cyclic)', 'finite world (reflecting)']
+            'finite world (cyclic)', 'finite world (reflecting)',
+            'finite world (unfolded navigator)',
+            'finite world (cyclic, fast forward)',
+            'finite world (virtual 9x9 array)',
+            'finite world (mirror quarter cell)',
+            'finite world (cyclic, parallel world scorer)']
         de = 0.02 # MeV
         self.e_bins = np.arange(0.0, 1.0+de, de) #ensure the final bin is considered
         dpz = 0.02 #
@@ -47,13 +53,17 @@ class Analysis:
             this_mask = "(particle_type==2212)"
         #
         for i in np.arange(1,njobs+1):
-            filename = "scorer_"+self.particle_name+"_"+np.str(mode)+"_"+\
-                np.str(i)+".hdf5"
-            table = tables.open_file(filename)
-            vals = [x[quantity] for x in table.root.data.where(this_mask)]
-            if res is None: res = np.array(vals)
-            else: res = np.append(res,vals)
-            table.close()
+            basename = "scorer_"+self.particle_name+"_"+np.str(mode)+"_"+\
+                np.str(i)
+            # multithreaded jobs write one file per worker thread
+            filenames = glob.glob(basename+".hdf5") + \
+                glob.glob(basename+"_t*.hdf5")
+            for filename in filenames:
+                table = tables.open_file(filename)
+                vals = [x[quantity] for x in table.root.data.where(this_mask)]
+                if res is None: res = np.array(vals)
+                else: res = np.append(res,vals)
+                table.close()
         return res
 
     def process_and_plot(self):
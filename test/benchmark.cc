@@ -0,0 +1,115 @@
+#include "ActionInitialization.hh"
+#include "CreateRunManager.hh"
+#include "DetectorConstruction.hh"
+#include "SteppingAction.hh"
+#include "Shielding.hh"
+
+#include "G4PeriodicBoundaryPhysics.hh"
+#include "G4Timer.hh"
+#include "G4UImanager.hh"
+
+/*times a batch run of the test geometry and reports the cost per event and per
+step, so that configurations of the periodic boundary process can be compared
+
+Usage: ./benchmark <particle_name> <test_mode> <number_of_primaries> <dispatch>
+  <threads> <tasks> <safety>
+
+dispatch is 0 to force the process on every step, 1 to force it only in volumes
+that touch a periodic face. threads is the number of worker threads (1 runs the
+sequential run manager), and tasks is 1 to use the task based run manager.
+safety is 1 to wrap the safety across the periodic faces in mode 4, which
+tracks through the unfolded lattice; the steps of e- in a small cell may then
+be compared with those in the semi-infinite world of mode 0*/
+
+int main(int argc, char** argv)
+{
+
+  G4String particle_name = "e-";
+  if (argc >= 2 ) particle_name = argv[1];
+
+  G4int test_mode = 2;
+  if (argc >= 3) test_mode = atoi(argv[2]);
+
+  G4int number_of_primaries = 1000;
+  if (argc >= 4) number_of_primaries = atoi(argv[3]);
+
+  G4int dispatch = 1;
+  if (argc >= 5) dispatch = atoi(argv[4]);
+
+  G4int number_of_threads = 1;
+  if (argc >= 6) number_of_threads = atoi(argv[5]);
+
+  G4bool use_tasks = false;
+  if (argc >= 7) use_tasks = atoi(argv[6]);
+
+  G4bool wrapped_safety = false;
+  if (argc >= 8) wrapped_safety = atoi(argv[7]);
+
+  G4RunManager* run_manager = CreateRunManager(number_of_threads, use_tasks);
+
+  CLHEP::HepRandom::setTheEngine(new CLHEP::RanecuEngine);
+  CLHEP::HepRandom::setTheSeed(1);
+
+  G4String run_id = "benchmark_" + particle_name + "_" + std::to_string(test_mode)
+    + "_" + std::to_string(dispatch) + "_" + std::to_string(number_of_threads)
+    + "_" + std::to_string(wrapped_safety);
+
+  DetectorConstruction* dc = new DetectorConstruction(run_id, test_mode);
+  run_manager->SetUserInitialization(dc);
+
+  Shielding* physics_list = new Shielding();
+
+  G4PeriodicBoundaryMode boundary_mode = (test_mode == 4) ? fPeriodicNavigator
+    : fPeriodicBoundaryProcess;
+
+  G4PeriodicBoundaryPhysics* PBC = new G4PeriodicBoundaryPhysics("Cyclic", true,
+    true, false, (test_mode == 3), boundary_mode);
+  PBC->SetDispatchMode(dispatch ? fDispatchPeriodicFace : fDispatchEveryStep);
+  PBC->SetWrappedSafety(wrapped_safety);
+
+  if (test_mode >= 2 && test_mode <= 4) physics_list->RegisterPhysics(PBC);
+
+  run_manager->SetUserInitialization(physics_list);
+
+  run_manager->SetUserInitialization(new ActionInitialization(true));
+
+  run_manager->Initialize();
+
+  G4UImanager* ui_manager = G4UImanager::GetUIpointer();
+  ui_manager->ApplyCommand("/control/execute config.mac");
+  ui_manager->ApplyCommand("/run/verbose 0");
+  ui_manager->ApplyCommand("/gps/pos/centre 0. 0. " +
+    std::to_string(dc->GetWorldZ()/2.0) + " mm");
+  ui_manager->ApplyCommand("/gps/particle " + particle_name);
+
+  //build the physics tables outside of the timed run
+  run_manager->BeamOn(0);
+  SteppingAction::Reset();
+
+  G4Timer timer;
+  timer.Start();
+  run_manager->BeamOn(number_of_primaries);
+  timer.Stop();
+
+  G4long steps = SteppingAction::GetNumberOfSteps();
+  G4double seconds = timer.GetRealElapsed();
+
+  G4cout << "BENCHMARK particle " << particle_name
+    << " mode " << test_mode
+    << " dispatch " << dispatch
+    << " threads " << number_of_threads
+    << " tasks " << use_tasks
+    << " safety " << wrapped_safety
+    << " events " << number_of_primaries
+    << " steps " << steps
+    << " seconds " << seconds
+    << " events_per_second " << number_of_primaries / seconds
+    << " us_per_event " << 1e6 * seconds / number_of_primaries
+    << " ns_per_step " << (steps ? 1e9 * seconds / steps : 0.)
+    << G4endl;
+
+  delete run_manager;
+
+  return 0;
+
+}
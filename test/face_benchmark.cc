@@ -0,0 +1,116 @@
+#include "G4Box.hh"
+#include "G4GeometryManager.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Navigator.hh"
+#include "G4NistManager.hh"
+#include "G4PeriodicBoundaryBuilder.hh"
+#include "G4PeriodicCell.hh"
+#include "G4PVPlacement.hh"
+#include "G4GeometryTolerance.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include <chrono>
+#include <vector>
+
+/*compares the cost of identifying the crossed periodic face from the navigator
+exit normal with the analytic lookup against the cell half lengths
+
+Usage: ./face_benchmark <number_of_crossings>*/
+
+int main(int argc, char** argv)
+{
+
+  G4int number_of_crossings = 1000000;
+  if (argc >= 2) number_of_crossings = atoi(argv[1]);
+
+  G4Material* air = G4NistManager::Instance()->FindOrBuildMaterial("G4_AIR");
+
+  double world_xy = 2*mm;
+  double world_z = 10*mm;
+
+  G4Box* world = new G4Box("world", world_xy/2, world_xy/2, world_z/2);
+  G4LogicalVolume* logical_world = new G4LogicalVolume(world, air, "logical_world");
+  G4VPhysicalVolume* physical_world = new G4PVPlacement(0, G4ThreeVector(),
+    logical_world, "physical_world", 0, false, 0);
+
+  G4PeriodicBoundaryBuilder* pbb = new G4PeriodicBoundaryBuilder();
+  pbb->Construct(logical_world);
+
+  G4GeometryManager::GetInstance()->CloseGeometry(true);
+
+  G4Navigator* navigator = new G4Navigator();
+  navigator->SetWorldVolume(physical_world);
+
+  G4PeriodicCell cell(G4ThreeVector(world_xy/2, world_xy/2, world_z/2),
+    G4AffineTransform(), G4GeometryTolerance::GetInstance()->GetSurfaceTolerance());
+
+  //random starting points inside the cell, heading for a lateral face
+  std::vector<G4ThreeVector> starts, directions, crossings;
+
+  for (G4int i = 0; i < number_of_crossings; ++i) {
+    G4ThreeVector start((G4UniformRand() - 0.5) * world_xy,
+      (G4UniformRand() - 0.5) * world_xy, (G4UniformRand() - 0.5) * world_z);
+    G4double phi = twopi * G4UniformRand();
+    G4double cost = 0.2 * (G4UniformRand() - 0.5);
+    G4double sint = std::sqrt(1 - cost*cost);
+    starts.push_back(start);
+    directions.push_back(G4ThreeVector(sint*std::cos(phi), sint*std::sin(phi), cost));
+  }
+
+  //move to the face as transportation does, optionally asking for the normal
+  auto cross = [&](bool with_normal) {
+    G4int on_plane = 0;
+    crossings.clear();
+    for (G4int i = 0; i < number_of_crossings; ++i) {
+      G4double safety;
+      navigator->LocateGlobalPointAndSetup(starts[i], &directions[i], false, false);
+      G4double step = navigator->ComputeStep(starts[i], directions[i], kInfinity, safety);
+      G4ThreeVector point = starts[i] + step * directions[i];
+      navigator->SetGeometricallyLimitedStep();
+      navigator->LocateGlobalPointAndSetup(point, &directions[i], true, false);
+      crossings.push_back(point);
+      if (with_normal) {
+        G4bool valid;
+        G4ThreeVector normal = navigator->GetGlobalExitNormal(point, &valid);
+        if (normal.isParallel(G4ThreeVector(1,0,0)) ||
+            normal.isParallel(G4ThreeVector(0,1,0)) ||
+            normal.isParallel(G4ThreeVector(0,0,1))) on_plane++;
+      }
+    }
+    return on_plane;
+  };
+
+  typedef std::chrono::steady_clock clock;
+
+  auto t0 = clock::now();
+  cross(false);
+  auto t1 = clock::now();
+  G4int navigator_faces = cross(true);
+  auto t2 = clock::now();
+
+  G4int analytic_faces = 0;
+  for (G4int i = 0; i < number_of_crossings; ++i)
+    if (G4PeriodicCell::CountFaces(cell.LocateFaces(crossings[i])) == 1)
+      analytic_faces++;
+  auto t3 = clock::now();
+
+  G4double ns_transport = std::chrono::duration<double, std::nano>(t1 - t0).count();
+  G4double ns_navigator = std::chrono::duration<double, std::nano>(t2 - t1).count()
+    - ns_transport;
+  G4double ns_analytic = std::chrono::duration<double, std::nano>(t3 - t2).count();
+
+  G4cout << "crossings " << number_of_crossings
+    << " navigator_faces " << navigator_faces
+    << " analytic_faces " << analytic_faces << G4endl;
+  G4cout << "navigator normal ns per crossing "
+    << ns_navigator / number_of_crossings << G4endl;
+  G4cout << "analytic face ns per crossing "
+    << ns_analytic / number_of_crossings << G4endl;
+
+  delete navigator;
+
+  return 0;
+
+}
@@ -0,0 +1,211 @@
+#include "DetectorConstruction.hh"
+#include "Shielding.hh"
+
+#include "G4Event.hh"
+#include "G4FastSimulationPhysics.hh"
+#include "G4Gamma.hh"
+#include "G4ParticleGun.hh"
+#include "G4PeriodicBoundaryPhysics.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4RunManager.hh"
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4UserEventAction.hh"
+#include "G4UserSteppingAction.hh"
+#include "G4VProcess.hh"
+#include "G4VUserActionInitialization.hh"
+#include "G4VUserPrimaryGeneratorAction.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cmath>
+
+/*fires gammas through the cyclic test geometry at small angles to its periodic
+faces, so that each crosses many cells before it first interacts, and reports
+the depth below the source and the path length of the first interaction of
+each primary. in mode 5 the gammas are fast forwarded through the crossings by
+G4PeriodicFastForwardModel, in mode 2 they are cycled step by step, and the two
+must agree, see run_fast_forward_test.sh
+
+Usage: ./fast_forward_test <mode> <number_of_primaries>
+
+the exit code is non-zero if any event is aborted, or if no fast step is taken
+in mode 5*/
+
+namespace {
+
+G4double half_xy = 0.;
+G4double half_z = 0.;
+G4double source_z = 0.;
+
+G4long interacted = 0;
+G4double sum_depth = 0., sum_depth2 = 0.;
+G4double sum_length = 0., sum_length2 = 0.;
+G4long fast_steps = 0;
+G4int aborted = 0;
+
+G4bool first_interaction = true;
+
+class ShallowGun : public G4VUserPrimaryGeneratorAction
+{
+  public:
+    ShallowGun() : G4VUserPrimaryGeneratorAction()
+    {
+      gun = new G4ParticleGun(1);
+      gun->SetParticleDefinition(G4Gamma::Definition());
+      gun->SetParticleEnergy(100*keV);
+    }
+
+    virtual ~ShallowGun() { delete gun; }
+
+    virtual void GeneratePrimaries(G4Event* event)
+    {
+      G4double x = (2*G4UniformRand() - 1) * half_xy;
+      G4double y = (2*G4UniformRand() - 1) * half_xy;
+
+      //a few degrees below the plane of the periodic faces at most
+      G4double dz = -(0.005 + 0.045*G4UniformRand());
+      G4double phi = twopi*G4UniformRand();
+      G4double along = std::sqrt(1. - dz*dz);
+
+      gun->SetParticlePosition(G4ThreeVector(x, y, source_z));
+      gun->SetParticleMomentumDirection(G4ThreeVector(along*std::cos(phi),
+        along*std::sin(phi), dz));
+      gun->GeneratePrimaryVertex(event);
+    }
+
+  private:
+    G4ParticleGun* gun;
+};
+
+class FirstInteraction : public G4UserEventAction
+{
+  public:
+    virtual void BeginOfEventAction(const G4Event*)
+    {
+      first_interaction = true;
+    }
+
+    virtual void EndOfEventAction(const G4Event* event)
+    {
+      if (event->IsAborted()) aborted++;
+    }
+};
+
+class InteractionDepth : public G4UserSteppingAction
+{
+  public:
+    virtual void UserSteppingAction(const G4Step* step)
+    {
+      const G4Track* track = step->GetTrack();
+      if (track->GetTrackID() != 1) return;
+
+      const G4StepPoint* post = step->GetPostStepPoint();
+      const G4VProcess* process = post->GetProcessDefinedStep();
+      if (!process) return;
+
+      if (process->GetProcessType() == fParameterisation
+          && step->GetStepLength() > 0.)
+        fast_steps++;
+
+      if (!first_interaction) return;
+
+      switch (process->GetProcessType()) {
+        case fElectromagnetic:
+        case fHadronic:
+        case fPhotolepton_hadron:
+        case fDecay:
+          break;
+        default:
+          return;
+      }
+
+      first_interaction = false;
+
+      G4double depth = source_z - post->GetPosition().z();
+      G4double length = track->GetTrackLength();
+
+      interacted++;
+      sum_depth += depth;
+      sum_depth2 += depth*depth;
+      sum_length += length;
+      sum_length2 += length*length;
+    }
+};
+
+class FastForwardTestActions : public G4VUserActionInitialization
+{
+  public:
+    virtual void Build() const
+    {
+      SetUserAction(new ShallowGun());
+      SetUserAction(new FirstInteraction());
+      SetUserAction(new InteractionDepth());
+    }
+};
+
+//the mean of a sum and its standard error
+void Mean(G4double sum, G4double sum2, G4long n, G4double& mean,
+  G4double& error)
+{
+  mean = error = 0.;
+  if (n < 2) return;
+  mean = sum/n;
+  error = std::sqrt(std::max(0., sum2/n - mean*mean)/(n - 1));
+}
+
+}
+
+int main(int argc, char** argv)
+{
+
+  G4int mode = 5;
+  if (argc >= 2) mode = atoi(argv[1]);
+
+  G4int number_of_primaries = 10000;
+  if (argc >= 3) number_of_primaries = atoi(argv[2]);
+
+  G4RunManager* run_manager = new G4RunManager();
+
+  DetectorConstruction* dc = new DetectorConstruction("fast_forward_test",
+    mode);
+  run_manager->SetUserInitialization(dc);
+
+  half_xy = dc->GetWorldXY()/2.;
+  half_z = dc->GetWorldZ()/2.;
+  source_z = 0.8*half_z;
+
+  Shielding* physics_list = new Shielding();
+  physics_list->RegisterPhysics(new G4PeriodicBoundaryPhysics("Cyclic"));
+
+  if (mode == 5) {
+    G4FastSimulationPhysics* fast_simulation = new G4FastSimulationPhysics();
+    fast_simulation->ActivateFastSimulation("gamma");
+    physics_list->RegisterPhysics(fast_simulation);
+  }
+
+  run_manager->SetUserInitialization(physics_list);
+
+  run_manager->SetUserInitialization(new FastForwardTestActions());
+
+  run_manager->Initialize();
+
+  run_manager->BeamOn(number_of_primaries);
+
+  G4double depth, depth_error, length, length_error;
+  Mean(sum_depth, sum_depth2, interacted, depth, depth_error);
+  Mean(sum_length, sum_length2, interacted, length, length_error);
+
+  G4cout << "FAST_FORWARD_TEST mode " << mode << " primaries "
+    << number_of_primaries << " interacted " << interacted << " depth "
+    << depth/mm << " +- " << depth_error/mm << " mm length " << length/mm
+    << " +- " << length_error/mm << " mm fast_steps " << fast_steps
+    << " aborted " << aborted << G4endl;
+
+  G4bool ok = (aborted == 0 && (mode != 5 || fast_steps > 0));
+
+  delete run_manager;
+
+  return ok ? 0 : 1;
+
+}
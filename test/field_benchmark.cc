@@ -0,0 +1,255 @@
+#include "G4Box.hh"
+#include "G4Electron.hh"
+#include "G4Event.hh"
+#include "G4FieldManager.hh"
+#include "G4LogicalVolume.hh"
+#include "G4NistManager.hh"
+#include "G4ParticleGun.hh"
+#include "G4PeriodicBoundaryBuilder.hh"
+#include "G4PeriodicBoundaryPhysics.hh"
+#include "G4PeriodicImageInformation.hh"
+#include "G4PeriodicStatistics.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4PropagatorInField.hh"
+#include "G4PVPlacement.hh"
+#include "G4RunManager.hh"
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Timer.hh"
+#include "G4TransportationManager.hh"
+#include "G4UniformMagField.hh"
+#include "G4UserEventAction.hh"
+#include "G4UserSteppingAction.hh"
+#include "G4VUserActionInitialization.hh"
+#include "G4VUserDetectorConstruction.hh"
+#include "G4VUserPrimaryGeneratorAction.hh"
+#include "Randomize.hh"
+#include "Shielding.hh"
+
+#include <cmath>
+
+/*times electrons spiralling in a uniform magnetic field along z through a
+vacuum slab, periodic in x and y, and compares the cost with that of a finite
+world large enough to hold the whole helix, as field studies otherwise need.
+each electron starts near the bottom of the slab and makes about the given
+number of turns of a 5 cm radius before leaving through its top, crossing the
+faces of the 2 mm cell a few hundred times per turn
+
+Usage: ./field_benchmark <mode> <number_of_primaries> <turns>
+  <delta_intersection_um>
+
+mode 0 is the finite world, 1 the periodic boundary process, 2 the periodic
+transportation and 3 the periodic navigator. the steps of the field
+propagator are limited to the radius of the helix in every mode. the delta
+intersection, 10 micrometres by default, is larger than the default recovery
+distance of the boundary process, so that the ends of the curved steps at the
+faces must be recovered within it
+
+the largest distance of the unwrapped position of an electron from its helix
+is reported as a check of the propagation through the faces. the exit code is
+non-zero if any event is aborted*/
+
+namespace {
+
+const G4double kField = 1*tesla;
+const G4double kRadius = 5*cm;
+const G4double kCell = 2*mm;
+const G4double kHalfZ = 10*cm;
+
+G4int mode = 3;
+G4int turns = 20;
+G4double delta_intersection = 10*micrometer;
+
+//the axis of the helix of the current event, and the results of the run
+G4ThreeVector axis;
+G4long steps = 0;
+G4int aborted = 0;
+G4double max_deviation = 0.;
+
+class FieldDetector : public G4VUserDetectorConstruction
+{
+  public:
+    virtual G4VPhysicalVolume* Construct()
+    {
+      G4Material* vacuum =
+        G4NistManager::Instance()->FindOrBuildMaterial("G4_Galactic");
+
+      //the finite world holds the helix from any starting point in the cell
+      G4double half_xy = (mode == 0) ? 2*kRadius + kCell : kCell/2;
+
+      G4LogicalVolume* logical_world = new G4LogicalVolume(
+        new G4Box("world", half_xy, half_xy, kHalfZ), vacuum, "logical_world");
+      G4VPhysicalVolume* physical_world = new G4PVPlacement(0, G4ThreeVector(),
+        logical_world, "physical_world", 0, false, 0);
+
+      if (mode > 0) {
+        G4PeriodicBoundaryBuilder* pbb = new G4PeriodicBoundaryBuilder();
+        pbb->Construct(logical_world);
+      }
+
+      return physical_world;
+    }
+
+    virtual void ConstructSDandField()
+    {
+      G4UniformMagField* field =
+        new G4UniformMagField(G4ThreeVector(0, 0, kField));
+
+      G4TransportationManager* manager =
+        G4TransportationManager::GetTransportationManager();
+
+      G4FieldManager* field_manager = manager->GetFieldManager();
+      field_manager->SetDetectorField(field);
+      field_manager->CreateChordFinder(field);
+      field_manager->SetDeltaIntersection(delta_intersection);
+
+      //without a limit, a step in the finite world may follow many turns
+      manager->GetPropagatorInField()->SetLargestAcceptableStep(kRadius);
+    }
+};
+
+class HelixGun : public G4VUserPrimaryGeneratorAction
+{
+  public:
+    HelixGun() : G4VUserPrimaryGeneratorAction()
+    {
+      gun = new G4ParticleGun(1);
+      gun->SetParticleDefinition(G4Electron::Definition());
+    }
+
+    virtual ~HelixGun() { delete gun; }
+
+    virtual void GeneratePrimaries(G4Event* event)
+    {
+      //the transverse momentum giving the radius, and the longitudinal one
+      //taking the electron through the slab in the given number of turns
+      G4double p_t = kRadius * c_light * kField;
+      G4double p_z = p_t * (2*kHalfZ - 2*mm) / (turns * twopi * kRadius);
+
+      G4double phi = twopi * G4UniformRand();
+      G4ThreeVector transverse(std::cos(phi), std::sin(phi), 0);
+
+      G4ThreeVector position((G4UniformRand() - 0.5) * kCell,
+        (G4UniformRand() - 0.5) * kCell, -kHalfZ + 1*mm);
+
+      //an electron turns towards -v x B
+      axis = position - kRadius * transverse.cross(G4ThreeVector(0, 0, 1));
+      axis.setZ(0);
+
+      gun->SetParticlePosition(position);
+      gun->SetParticleMomentum(p_t * transverse + G4ThreeVector(0, 0, p_z));
+      gun->GeneratePrimaryVertex(event);
+    }
+
+  private:
+    G4ParticleGun* gun;
+};
+
+class HelixDeviation : public G4UserSteppingAction
+{
+  public:
+    virtual void UserSteppingAction(const G4Step* step)
+    {
+      steps++;
+
+      const G4Track* track = step->GetTrack();
+      if (track->GetParentID() != 0) return;
+
+      G4ThreeVector position =
+        G4PeriodicImageInformation::GetUnwrappedPosition(track);
+      G4double rho = (position - axis).perp();
+
+      max_deviation = std::max(max_deviation, std::fabs(rho - kRadius));
+    }
+};
+
+class AbortCount : public G4UserEventAction
+{
+  public:
+    virtual void EndOfEventAction(const G4Event* event)
+    {
+      if (event->IsAborted()) aborted++;
+    }
+};
+
+class FieldBenchmarkActions : public G4VUserActionInitialization
+{
+  public:
+    virtual void Build() const
+    {
+      SetUserAction(new HelixGun());
+      SetUserAction(new HelixDeviation());
+      SetUserAction(new AbortCount());
+    }
+};
+
+}
+
+int main(int argc, char** argv)
+{
+
+  if (argc >= 2) mode = atoi(argv[1]);
+
+  G4int number_of_primaries = 100;
+  if (argc >= 3) number_of_primaries = atoi(argv[2]);
+
+  if (argc >= 4) turns = atoi(argv[3]);
+
+  if (argc >= 5) delta_intersection = atof(argv[4]) * micrometer;
+
+  G4RunManager* run_manager = new G4RunManager();
+
+  CLHEP::HepRandom::setTheEngine(new CLHEP::RanecuEngine);
+  CLHEP::HepRandom::setTheSeed(1);
+
+  run_manager->SetUserInitialization(new FieldDetector());
+
+  G4PeriodicBoundaryMode boundary_mode = (mode == 3) ? fPeriodicNavigator
+    : (mode == 2) ? fPeriodicTransportation : fPeriodicBoundaryProcess;
+
+  Shielding* physics_list = new Shielding();
+  if (mode > 0)
+    physics_list->RegisterPhysics(new G4PeriodicBoundaryPhysics("Cyclic", true,
+      true, false, false, boundary_mode));
+  run_manager->SetUserInitialization(physics_list);
+
+  run_manager->SetUserInitialization(new FieldBenchmarkActions());
+
+  run_manager->Initialize();
+
+  //build the physics tables outside of the timed run
+  run_manager->BeamOn(0);
+  G4PeriodicStatistics::ResetAll();
+
+  G4Timer timer;
+  timer.Start();
+  run_manager->BeamOn(number_of_primaries);
+  timer.Stop();
+
+  G4PeriodicStatistics total;
+  G4PeriodicStatistics::Merge(total);
+
+  G4long crossings = 0;
+  for (G4int pair = 0; pair < G4PeriodicCell::kMaxFacePairs; ++pair)
+    crossings += total.GetPairCrossings(pair);
+
+  G4double seconds = timer.GetRealElapsed();
+
+  G4cout << "FIELD_BENCHMARK mode " << mode
+    << " turns " << turns
+    << " delta_intersection_um " << delta_intersection/micrometer
+    << " events " << number_of_primaries
+    << " steps " << steps
+    << " crossings " << crossings
+    << " recoveries " << total.GetRecoveries()
+    << " aborted " << aborted
+    << " seconds " << seconds
+    << " us_per_event " << 1e6 * seconds / number_of_primaries
+    << " max_deviation_um " << max_deviation/micrometer
+    << G4endl;
+
+  delete run_manager;
+
+  return aborted ? 1 : 0;
+
+}
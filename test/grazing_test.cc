@@ -0,0 +1,157 @@
+#include "DetectorConstruction.hh"
+#include "Shielding.hh"
+
+#include "G4Event.hh"
+#include "G4Geantino.hh"
+#include "G4ParticleGun.hh"
+#include "G4PeriodicBoundaryPhysics.hh"
+#include "G4RunManager.hh"
+#include "G4Step.hh"
+#include "G4UserEventAction.hh"
+#include "G4UserSteppingAction.hh"
+#include "G4VUserActionInitialization.hh"
+#include "G4VUserPrimaryGeneratorAction.hh"
+#include "Randomize.hh"
+
+#include <cmath>
+
+/*fires geantinos through the periodic world volume at grazing incidence on its
+faces, from points inside it, on its faces and on its edges, and checks that no
+event is aborted by the periodic boundary process and that no track leaves the
+world other than through its z faces, which are not periodic. the direction
+makes an angle between 1e-12 and 1e-3 rad with a face, so that steps end at or
+close to an edge and the exit normal of the navigator is least reliable
+
+Usage: ./grazing_test <number_of_primaries>
+
+returns a non-zero exit code if any event is aborted or any track is lost
+through a periodic face*/
+
+namespace {
+
+G4double half_xy = 0.;
+G4double half_z = 0.;
+G4long aborted = 0;
+G4long lost = 0;
+
+class GrazingGun : public G4VUserPrimaryGeneratorAction
+{
+  public:
+    GrazingGun() : G4VUserPrimaryGeneratorAction()
+    {
+      gun = new G4ParticleGun(1);
+      gun->SetParticleDefinition(G4Geantino::Definition());
+      gun->SetParticleEnergy(1*MeV);
+    }
+
+    virtual ~GrazingGun() { delete gun; }
+
+    virtual void GeneratePrimaries(G4Event* event)
+    {
+      G4double x = (2*G4UniformRand() - 1) * half_xy;
+      G4double y = (2*G4UniformRand() - 1) * half_xy;
+
+      //a third of the particles start on a face, a third on an edge
+      G4double where = G4UniformRand();
+      if (where < 2./3.) x = (G4UniformRand() < 0.5) ? -half_xy : half_xy;
+      if (where < 1./3.) y = (G4UniformRand() < 0.5) ? -half_xy : half_xy;
+
+      //grazing the x or the y faces, leaving the cell through z in the end
+      G4double graze = std::pow(10., -12. + 9.*G4UniformRand());
+      G4double dz = -(0.05 + 0.5*G4UniformRand());
+      G4double along = std::sqrt(1. - dz*dz - graze*graze);
+      G4double sign = (G4UniformRand() < 0.5) ? -1. : 1.;
+
+      G4ThreeVector direction = (G4UniformRand() < 0.5) ?
+        G4ThreeVector(sign*graze, along, dz) : G4ThreeVector(along, sign*graze, dz);
+
+      gun->SetParticlePosition(G4ThreeVector(x, y, 0.9*half_z));
+      gun->SetParticleMomentumDirection(direction.unit());
+      gun->GeneratePrimaryVertex(event);
+    }
+
+  private:
+    G4ParticleGun* gun;
+};
+
+class AbortCount : public G4UserEventAction
+{
+  public:
+    virtual void EndOfEventAction(const G4Event* event)
+    {
+      if (event->IsAborted()) aborted++;
+    }
+};
+
+class LostTracks : public G4UserSteppingAction
+{
+  public:
+    virtual void UserSteppingAction(const G4Step* step)
+    {
+      const G4StepPoint* post = step->GetPostStepPoint();
+      if (post->GetStepStatus() != fWorldBoundary) return;
+
+      //the world only extends beyond the periodic volume by its buffer, a
+      //track leaving it within the z faces has left through an x or y face
+      if (std::fabs(post->GetPosition().z()) <= half_z) lost++;
+    }
+};
+
+class GrazingTestActions : public G4VUserActionInitialization
+{
+  public:
+    virtual void Build() const
+    {
+      SetUserAction(new GrazingGun());
+      SetUserAction(new AbortCount());
+      SetUserAction(new LostTracks());
+    }
+};
+
+}
+
+int main(int argc, char** argv)
+{
+
+  G4int number_of_primaries = 10000;
+  if (argc >= 2) number_of_primaries = atoi(argv[1]);
+
+  G4RunManager* run_manager = new G4RunManager();
+
+  DetectorConstruction* dc = new DetectorConstruction("grazing_test", 2);
+  run_manager->SetUserInitialization(dc);
+
+  half_xy = dc->GetWorldXY()/2.;
+  half_z = dc->GetWorldZ()/2.;
+
+  Shielding* physics_list = new Shielding();
+  physics_list->RegisterPhysics(new G4PeriodicBoundaryPhysics("Cyclic"));
+  run_manager->SetUserInitialization(physics_list);
+
+  run_manager->SetUserInitialization(new GrazingTestActions());
+
+  run_manager->Initialize();
+
+  run_manager->BeamOn(number_of_primaries);
+
+  const G4PeriodicStatistics& statistics =
+    G4PeriodicBoundaryPhysics::GetBoundaryProcess()->GetStatistics();
+  statistics.Print(G4cout);
+
+  G4long crossings = 0;
+  for (G4int pair = 0; pair < G4PeriodicCell::kMaxFacePairs; ++pair)
+    crossings += statistics.GetPairCrossings(pair);
+
+  G4cout << "crossings " << crossings << " recovered "
+    << statistics.GetRecoveries() << " too small "
+    << statistics.GetStepsTooSmall() << " aborted events " << aborted
+    << " lost tracks " << lost << G4endl;
+
+  G4bool ok = (aborted == 0 && lost == 0 && statistics.GetAbortedEvents() == 0
+    && crossings > 0);
+
+  delete run_manager;
+
+  return ok ? 0 : 1;
+
+}
@@ -5,10 +5,13 @@
 class ActionInitialization : public G4VUserActionInitialization
 {
   public:
-    ActionInitialization();
+    ActionInitialization(bool count_steps=false);
     virtual ~ActionInitialization();
 
     virtual void BuildForMaster() const;
     virtual void Build() const;
 
+  private:
+    bool count_steps;
+
 };
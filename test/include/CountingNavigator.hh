@@ -0,0 +1,24 @@
+#pragma once
+
+#include "G4Navigator.hh"
+#include "globals.hh"
+
+/*a tracking navigator that counts the number of times a point is located,
+used to test the number of locates made per periodic crossing*/
+
+class CountingNavigator : public G4Navigator
+{
+  public:
+    CountingNavigator();
+    virtual ~CountingNavigator();
+
+    virtual G4VPhysicalVolume* LocateGlobalPointAndSetup(
+      const G4ThreeVector& point, const G4ThreeVector* direction=0,
+      const G4bool pRelativeSearch=true, const G4bool ignoreDirection=true);
+
+    G4long GetNumberOfLocates(){return number_of_locates;};
+
+  private:
+    G4long number_of_locates;
+
+};
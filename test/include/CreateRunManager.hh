@@ -0,0 +1,37 @@
+#pragma once
+
+#include "G4RunManager.hh"
+#include "G4Version.hh"
+#include "globals.hh"
+
+#ifdef G4MULTITHREADED
+#include "G4MTRunManager.hh"
+#if G4VERSION_NUMBER >= 1070
+#include "G4TaskRunManager.hh"
+#endif
+#endif
+
+/*creates the sequential run manager for a single thread, otherwise the
+multithreaded run manager, or the task based one if requested and available.
+the number of threads is ignored by a sequential build of Geant4*/
+
+inline G4RunManager* CreateRunManager(G4int number_of_threads, G4bool use_tasks=false)
+{
+#ifdef G4MULTITHREADED
+  if (number_of_threads > 1) {
+#if G4VERSION_NUMBER >= 1070
+    if (use_tasks) {
+      G4TaskRunManager* task_run_manager = new G4TaskRunManager();
+      task_run_manager->SetNumberOfThreads(number_of_threads);
+      return task_run_manager;
+    }
+#endif
+    G4MTRunManager* mt_run_manager = new G4MTRunManager();
+    mt_run_manager->SetNumberOfThreads(number_of_threads);
+    return mt_run_manager;
+  }
+#endif
+  (void) number_of_threads;
+  (void) use_tasks;
+  return new G4RunManager();
+}
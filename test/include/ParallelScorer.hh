@@ -0,0 +1,28 @@
+#pragma once
+
+#include "G4VUserParallelWorld.hh"
+#include "globals.hh"
+
+class G4LogicalVolume;
+
+/*the scorer of the test geometry, placed in a parallel world instead of in the
+periodic world volume. the parallel world is not periodic; it covers the
+cell, within which the boundary process keeps the particles*/
+
+class ParallelScorer : public G4VUserParallelWorld
+{
+  public:
+
+    ParallelScorer(G4String world_name, G4String runid, double xy, double z);
+   ~ParallelScorer();
+
+    virtual void Construct();
+    virtual void ConstructSD();
+
+  private:
+    G4LogicalVolume* logical_scorer;
+    G4String run_id;
+    double world_xy;
+    double world_size_z;
+
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "G4UserRunAction.hh"
+#include "globals.hh"
+
+/*adds the steps counted by a thread to the total at the end of each run*/
+
+class RunAction : public G4UserRunAction
+{
+  public:
+    RunAction();
+    virtual ~RunAction();
+
+    virtual void EndOfRunAction(const G4Run*);
+
+};
@@ -35,6 +35,10 @@ struct Packet
     double direction_y;
     double direction_z;
 
+    double unwrapped_x;
+    double unwrapped_y;
+    double unwrapped_z;
+
 };
 
 
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "G4UserSteppingAction.hh"
+#include "globals.hh"
+
+#include <atomic>
+
+/*counts the steps taken, used by the benchmark to normalise run time per step.
+each thread counts its own steps, which are added to the total at the end of
+each run by the run action, so that counting does not serialise the threads*/
+
+class SteppingAction : public G4UserSteppingAction
+{
+  public:
+    SteppingAction();
+    virtual ~SteppingAction();
+
+    virtual void UserSteppingAction(const G4Step*);
+
+    static G4long GetNumberOfSteps(){return number_of_steps;};
+    static void Reset(){number_of_steps = 0;};
+    static void Flush(){number_of_steps += thread_steps; thread_steps = 0;};
+
+  private:
+    static std::atomic<G4long> number_of_steps;
+    static G4ThreadLocal G4long thread_steps;
+
+};
@@ -0,0 +1,122 @@
+#include "CountingNavigator.hh"
+#include "DetectorConstruction.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "Shielding.hh"
+
+#include "G4PeriodicBoundaryPhysics.hh"
+#include "G4RunManager.hh"
+#include "G4Step.hh"
+#include "G4TransportationManager.hh"
+#include "G4UImanager.hh"
+#include "G4UserSteppingAction.hh"
+#include "G4VUserActionInitialization.hh"
+
+/*checks that a periodic crossing costs exactly one locate by the periodic
+boundary process, on top of the locate made by transportation at the face, and
+that the stepping manager continues from the touchable of that locate
+
+Usage: ./locate_test <number_of_primaries>
+
+returns a non-zero exit code if any crossing fails the checks*/
+
+namespace {
+
+CountingNavigator* navigator = NULL;
+G4long crossings = 0;
+G4long failures = 0;
+
+class LocateCheck : public G4UserSteppingAction
+{
+  public:
+    LocateCheck() : G4UserSteppingAction() { last_count = 0; }
+
+    virtual void UserSteppingAction(const G4Step* step)
+    {
+      G4long count = navigator->GetNumberOfLocates();
+      G4long locates = count - last_count;
+      last_count = count;
+
+      //the first step includes the locate made when the track starts
+      if (step->GetTrack()->GetCurrentStepNumber() == 1) return;
+
+      G4StepPoint* pre = step->GetPreStepPoint();
+      G4StepPoint* post = step->GetPostStepPoint();
+
+      //geantinos move in straight lines, so a cycled step ends away from the
+      //point reached by transportation
+      G4ThreeVector reached = pre->GetPosition()
+        + step->GetStepLength() * pre->GetMomentumDirection();
+      if ((reached - post->GetPosition()).mag() < 1*micrometer) return;
+
+      crossings++;
+
+      G4bool ok = (locates == 2);
+
+      //the touchable handed over must be that of the relocated point
+      G4VPhysicalVolume* world = G4TransportationManager::GetTransportationManager()
+        ->GetNavigatorForTracking()->GetWorldVolume();
+      ok = ok && (post->GetTouchableHandle()->GetVolume() != world);
+
+      if (!ok) {
+        failures++;
+        G4cout << "crossing at " << post->GetPosition() << " with " << locates
+          << " locates, post step volume "
+          << post->GetTouchableHandle()->GetVolume()->GetName() << G4endl;
+      }
+    }
+
+  private:
+    G4long last_count;
+};
+
+class LocateTestActions : public G4VUserActionInitialization
+{
+  public:
+    virtual void Build() const
+    {
+      SetUserAction(new PrimaryGeneratorAction());
+      SetUserAction(new LocateCheck());
+    }
+};
+
+}
+
+int main(int argc, char** argv)
+{
+
+  G4int number_of_primaries = 1000;
+  if (argc >= 2) number_of_primaries = atoi(argv[1]);
+
+  G4RunManager* run_manager = new G4RunManager();
+
+  //the counting navigator must be in place before transportation is built
+  navigator = new CountingNavigator();
+  G4TransportationManager::GetTransportationManager()
+    ->SetNavigatorForTracking(navigator);
+
+  DetectorConstruction* dc = new DetectorConstruction("locate_test", 2);
+  run_manager->SetUserInitialization(dc);
+
+  Shielding* physics_list = new Shielding();
+  physics_list->RegisterPhysics(new G4PeriodicBoundaryPhysics("Cyclic"));
+  run_manager->SetUserInitialization(physics_list);
+
+  run_manager->SetUserInitialization(new LocateTestActions());
+
+  run_manager->Initialize();
+
+  G4UImanager* ui_manager = G4UImanager::GetUIpointer();
+  ui_manager->ApplyCommand("/control/execute config.mac");
+  ui_manager->ApplyCommand("/gps/pos/centre 0. 0. " +
+    std::to_string(dc->GetWorldZ()/2.0) + " mm");
+  ui_manager->ApplyCommand("/gps/particle geantino");
+
+  run_manager->BeamOn(number_of_primaries);
+
+  G4cout << "crossings " << crossings << " failures " << failures << G4endl;
+
+  delete run_manager;
+
+  return (failures == 0 && crossings > 0) ? 0 : 1;
+
+}
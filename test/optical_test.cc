@@ -0,0 +1,334 @@
+#include "G4Box.hh"
+#include "G4Event.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Material.hh"
+#include "G4MaterialPropertiesTable.hh"
+#include "G4NistManager.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4OpticalPhysics.hh"
+#include "G4ParticleGun.hh"
+#include "G4PeriodicBoundaryBuilder.hh"
+#include "G4PeriodicBoundaryPhysics.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4PVPlacement.hh"
+#include "G4RunManager.hh"
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Timer.hh"
+#include "G4UserEventAction.hh"
+#include "G4UserSteppingAction.hh"
+#include "G4VUserActionInitialization.hh"
+#include "G4VUserDetectorConstruction.hh"
+#include "G4VUserPrimaryGeneratorAction.hh"
+#include "Randomize.hh"
+#include "Shielding.hh"
+
+#include <cmath>
+
+/*tracks optical photons in an array of crystal pixels, either placed in full
+or as one periodic cell, and reports the fraction of photons leaving through
+the bottom of the array and the photons tracked per second. each pixel lies
+against the -x side of its cell, with an air gap on the +x side and on both
+sides in y, so that a photon crossing the -x face of the cell lands in the air
+gap of the next one and meets the crystal-air interface on the face itself.
+photons start isotropically in the central pixel with a random polarization,
+and are killed once they have travelled further than the array extends
+
+Usage: ./optical_test <mode> <number_of_events> <photons_per_event>
+
+mode 0 is the full array, 1 the periodic boundary process, 2 the periodic
+transportation, 3 the periodic navigator and 4 the boundary process with
+reflecting faces. mode 5 is the full array unfolded by those reflections,
+every other column of pixels mirrored in x, to be compared with mode 4. the
+fraction of each periodic mode must agree with that of its full array, see
+run_optical_test.sh
+
+modes 6, 7 and 8 are modes 1, 2 and 3 with every photon fired at the -x face
+beyond the critical angle of the x and y faces of the pixel. a photon crossing
+the face lands on the crystal-air interface there and is totally internally
+reflected back out through the face it landed on, so that no photon may ever
+travel through the air
+
+the polarization of every photon is checked after every step to be a unit
+vector normal to its direction. the exit code is non-zero if it is not, if
+any event is aborted, or if a photon travels through the air in modes 6 to 8*/
+
+namespace {
+
+const G4double kPitch = 3.2*mm;
+const G4double kGap = 0.2*mm;
+const G4double kHalfLength = 10*mm;
+const G4int kHalfColumns = 32;
+const G4double kMaxLength = 10*cm;
+
+G4int mode = 1;
+
+//the mode of the periodic boundary, and whether the photons are totally
+//internally reflected at the pixel faces
+G4int periodic_mode = 1;
+G4bool internal_reflection = false;
+
+//the pixel of the cell, against its -x face
+const G4ThreeVector kPixelCentre(-kGap/2, 0, 0);
+
+//photons leaving through the bottom, and those tracked in the run
+G4long bottom = 0;
+G4long photons = 0;
+G4long polarization_errors = 0;
+G4long transmitted = 0;
+G4int aborted = 0;
+
+class PixelArray : public G4VUserDetectorConstruction
+{
+  public:
+    virtual G4VPhysicalVolume* Construct()
+    {
+      G4NistManager* nist = G4NistManager::Instance();
+      G4Material* vacuum = nist->FindOrBuildMaterial("G4_Galactic");
+      G4Material* air = nist->FindOrBuildMaterial("G4_AIR");
+      G4Material* crystal = nist->FindOrBuildMaterial("G4_PbWO4");
+
+      //the vacuum has no refractive index, photons reaching it are absorbed
+      G4double energies[2] = {1.5*eV, 4.5*eV};
+      G4double air_rindex[2] = {1.0, 1.0};
+      G4double crystal_rindex[2] = {2.2, 2.2};
+      G4double crystal_absorption[2] = {1*m, 1*m};
+
+      G4MaterialPropertiesTable* air_properties = new G4MaterialPropertiesTable();
+      air_properties->AddProperty("RINDEX", energies, air_rindex, 2);
+      air->SetMaterialPropertiesTable(air_properties);
+
+      G4MaterialPropertiesTable* crystal_properties =
+        new G4MaterialPropertiesTable();
+      crystal_properties->AddProperty("RINDEX", energies, crystal_rindex, 2);
+      crystal_properties->AddProperty("ABSLENGTH", energies, crystal_absorption, 2);
+      crystal->SetMaterialPropertiesTable(crystal_properties);
+
+      G4LogicalVolume* logical_pixel = new G4LogicalVolume(
+        new G4Box("pixel", (kPitch - kGap)/2, (kPitch - kGap)/2, kHalfLength),
+        crystal, "logical_pixel");
+
+      if (periodic_mode >= 1 && periodic_mode <= 4) {
+
+        G4LogicalVolume* logical_world = new G4LogicalVolume(
+          new G4Box("world", kPitch/2, kPitch/2, kHalfLength), vacuum,
+          "logical_world");
+        G4VPhysicalVolume* physical_world = new G4PVPlacement(0,
+          G4ThreeVector(), logical_world, "physical_world", 0, false, 0);
+
+        G4PeriodicBoundaryBuilder* pbb = new G4PeriodicBoundaryBuilder();
+        G4LogicalVolume* logical_cell = pbb->Construct(logical_world);
+        logical_cell->SetMaterial(air);
+
+        new G4PVPlacement(0, kPixelCentre, logical_pixel, "physical_pixel",
+          logical_cell, false, 0, true);
+
+        return physical_world;
+      }
+
+      //the full array reaches beyond the furthest a photon may travel
+      G4double half_width = (kHalfColumns + 1) * kPitch;
+
+      G4LogicalVolume* logical_world = new G4LogicalVolume(
+        new G4Box("world", half_width + 1*cm, half_width + 1*cm,
+          kHalfLength + 1*cm), vacuum, "logical_world");
+      G4VPhysicalVolume* physical_world = new G4PVPlacement(0, G4ThreeVector(),
+        logical_world, "physical_world", 0, false, 0);
+
+      G4LogicalVolume* logical_array = new G4LogicalVolume(
+        new G4Box("array", half_width, half_width, kHalfLength), air,
+        "logical_array");
+      new G4PVPlacement(0, G4ThreeVector(), logical_array, "physical_array",
+        logical_world, false, 0);
+
+      G4int copy = 0;
+      for (G4int i = -kHalfColumns; i <= kHalfColumns; ++i) {
+        //a reflection through a face of the cell mirrors the next column
+        G4double x = (mode == 5 && i % 2) ? -kPixelCentre.x() : kPixelCentre.x();
+        for (G4int j = -kHalfColumns; j <= kHalfColumns; ++j)
+          new G4PVPlacement(0, G4ThreeVector(i*kPitch + x, j*kPitch, 0),
+            logical_pixel, "physical_pixel", logical_array, false, copy++);
+      }
+
+      return physical_world;
+    }
+};
+
+class PhotonGun : public G4VUserPrimaryGeneratorAction
+{
+  public:
+    PhotonGun(G4int n) : G4VUserPrimaryGeneratorAction(), photons_per_event(n)
+    {
+      gun = new G4ParticleGun(1);
+      gun->SetParticleDefinition(G4OpticalPhoton::Definition());
+      gun->SetParticleEnergy(3*eV);
+    }
+
+    virtual ~PhotonGun() { delete gun; }
+
+    virtual void GeneratePrimaries(G4Event* event)
+    {
+      for (G4int i = 0; i < photons_per_event; ++i) {
+
+        G4double cos_theta = 2*G4UniformRand() - 1;
+        G4double sin_theta = std::sqrt(1 - cos_theta*cos_theta);
+        G4double phi = twopi*G4UniformRand();
+        G4ThreeVector direction(sin_theta*std::cos(phi),
+          sin_theta*std::sin(phi), cos_theta);
+
+        //towards -x, and at least 50 degrees from the normals of the x and y
+        //faces, against a critical angle of 27 degrees
+        if (internal_reflection) {
+          G4double dx = -(0.1 + 0.5*G4UniformRand());
+          G4double dy = (2*G4UniformRand() - 1) * 0.6;
+          G4double dz = std::sqrt(1 - dx*dx - dy*dy);
+          direction.set(dx, dy, (G4UniformRand() < 0.5) ? -dz : dz);
+        }
+
+        //a random linear polarization normal to the direction
+        G4double angle = twopi*G4UniformRand();
+        G4ThreeVector e1 = direction.orthogonal().unit();
+        G4ThreeVector e2 = direction.cross(e1);
+
+        G4ThreeVector position = kPixelCentre + G4ThreeVector(
+          (G4UniformRand() - 0.5) * (kPitch - kGap),
+          (G4UniformRand() - 0.5) * (kPitch - kGap),
+          (2*G4UniformRand() - 1) * kHalfLength);
+
+        gun->SetParticlePosition(position);
+        gun->SetParticleMomentumDirection(direction);
+        gun->SetParticlePolarization(std::cos(angle)*e1 + std::sin(angle)*e2);
+        gun->GeneratePrimaryVertex(event);
+      }
+
+      photons += photons_per_event;
+    }
+
+  private:
+    G4ParticleGun* gun;
+    G4int photons_per_event;
+};
+
+class PhotonFate : public G4UserSteppingAction
+{
+  public:
+    virtual void UserSteppingAction(const G4Step* step)
+    {
+      G4Track* track = step->GetTrack();
+
+      const G4ThreeVector& direction = track->GetMomentumDirection();
+      const G4ThreeVector& polarization = track->GetPolarization();
+
+      if (std::fabs(polarization.mag() - 1) > 1e-6 ||
+          std::fabs(polarization * direction) > 1e-6)
+        polarization_errors++;
+
+      //a totally internally reflected photon only touches the air on the
+      //faces of the cell it lands on
+      if (internal_reflection && step->GetStepLength() > 1*um &&
+          step->GetPreStepPoint()->GetMaterial()->GetName() == "G4_AIR")
+        transmitted++;
+
+      G4VPhysicalVolume* volume = step->GetPostStepPoint()->GetPhysicalVolume();
+
+      if (volume && volume->GetName() == "physical_world") {
+        if (track->GetPosition().z() < 0) bottom++;
+        track->SetTrackStatus(fStopAndKill);
+      } else if (track->GetTrackLength() > kMaxLength) {
+        track->SetTrackStatus(fStopAndKill);
+      }
+    }
+};
+
+class AbortCount : public G4UserEventAction
+{
+  public:
+    virtual void EndOfEventAction(const G4Event* event)
+    {
+      if (event->IsAborted()) aborted++;
+    }
+};
+
+class OpticalTestActions : public G4VUserActionInitialization
+{
+  public:
+    OpticalTestActions(G4int n) : photons_per_event(n) {}
+
+    virtual void Build() const
+    {
+      SetUserAction(new PhotonGun(photons_per_event));
+      SetUserAction(new PhotonFate());
+      SetUserAction(new AbortCount());
+    }
+
+  private:
+    G4int photons_per_event;
+};
+
+}
+
+int main(int argc, char** argv)
+{
+
+  if (argc >= 2) mode = atoi(argv[1]);
+
+  internal_reflection = (mode >= 6);
+  periodic_mode = internal_reflection ? mode - 5 : mode;
+
+  G4int number_of_events = 100;
+  if (argc >= 3) number_of_events = atoi(argv[2]);
+
+  G4int photons_per_event = 1000;
+  if (argc >= 4) photons_per_event = atoi(argv[3]);
+
+  G4RunManager* run_manager = new G4RunManager();
+
+  CLHEP::HepRandom::setTheEngine(new CLHEP::RanecuEngine);
+  CLHEP::HepRandom::setTheSeed(1);
+
+  run_manager->SetUserInitialization(new PixelArray());
+
+  G4PeriodicBoundaryMode boundary_mode = (periodic_mode == 3) ?
+    fPeriodicNavigator : (periodic_mode == 2) ? fPeriodicTransportation
+    : fPeriodicBoundaryProcess;
+
+  Shielding* physics_list = new Shielding();
+  physics_list->RegisterPhysics(new G4OpticalPhysics());
+  if (periodic_mode >= 1 && periodic_mode <= 4)
+    physics_list->RegisterPhysics(new G4PeriodicBoundaryPhysics("Cyclic", true,
+      true, false, (periodic_mode == 4), boundary_mode));
+  run_manager->SetUserInitialization(physics_list);
+
+  run_manager->SetUserInitialization(new OpticalTestActions(photons_per_event));
+
+  run_manager->Initialize();
+
+  //build the physics tables outside of the timed run
+  run_manager->BeamOn(0);
+
+  G4Timer timer;
+  timer.Start();
+  run_manager->BeamOn(number_of_events);
+  timer.Stop();
+
+  G4double seconds = timer.GetRealElapsed();
+
+  G4double fraction = photons ? (G4double)bottom / photons : 0.;
+  G4double error = photons ? std::sqrt(fraction * (1 - fraction) / photons) : 0.;
+
+  G4cout << "OPTICAL_TEST mode " << mode
+    << " photons " << photons
+    << " bottom_fraction " << fraction
+    << " error " << error
+    << " aborted " << aborted
+    << " polarization_errors " << polarization_errors
+    << " seconds " << seconds
+    << " photons_per_second " << photons / seconds
+    << " transmitted " << transmitted
+    << G4endl;
+
+  delete run_manager;
+
+  return (aborted || polarization_errors || transmitted) ? 1 : 0;
+
+}
@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+# compare the per-step cost of the periodic boundary dispatch modes
+# run from the build directory: bash ../run_benchmark.sh
+
+NPARTICLES=${NPARTICLES:-10000}
+PARTICLENAMES=${PARTICLENAMES:-"geantino gamma e- neutron"}
+
+for particle in $PARTICLENAMES; do
+  for dispatch in 0 1; do
+    ./benchmark $particle 2 $NPARTICLES $dispatch | grep BENCHMARK
+  done
+done
+
+# compare the steps taken by e- in the small cyclic cell with those in the
+# semi-infinite world, with the safety stopping at the periodic faces and
+# wrapped across them
+for config in "0 0" "2 0" "4 0" "4 1"; do
+  set -- $config
+  ./benchmark e- $1 $NPARTICLES 1 1 0 $2 | grep BENCHMARK
+done
@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+# compare the depth and the path length of the first interaction of gammas
+# fast forwarded through the cyclic test geometry (mode 5) with those of gammas
+# cycled step by step (mode 2). exits non-zero if either mean differs by more
+# than five standard errors, or if a run fails its own checks
+# run from the build directory: bash ../run_fast_forward_test.sh
+
+set -o pipefail
+
+NPRIMARIES=${NPRIMARIES:-100000}
+
+status=0
+
+reference=$(./fast_forward_test 2 $NPRIMARIES | grep FAST_FORWARD_TEST) || status=1
+fast=$(./fast_forward_test 5 $NPRIMARIES | grep FAST_FORWARD_TEST) || status=1
+echo "$reference"
+echo "$fast"
+echo "$reference $fast" | awk '{
+  dd = $30 - $9; sd = sqrt($11*$11 + $32*$32);
+  dl = $35 - $14; sl = sqrt($16*$16 + $37*$37);
+  printf "depth: %.2f standard errors, length: %.2f standard errors\n",
+    (sd > 0 ? dd/sd : 0), (sl > 0 ? dl/sl : 0);
+  exit (dd*dd > 25*sd*sd || dl*dl > 25*sl*sl) }' || status=1
+
+exit $status
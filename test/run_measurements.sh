@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+# run every benchmark and validation driver of the test directory, and write
+# their result lines to measurements_<geant4 version>.txt for the record. the
+# finite world, mode 0, is the baseline of each comparison. exits non-zero if
+# any driver fails its own checks
+# run from the build directory of a release build: bash ../run_measurements.sh
+
+set -o pipefail
+
+SCRIPTS=$(dirname "$0")
+VERSION=$(geant4-config --version 2>/dev/null || echo unknown)
+OUTPUT=${OUTPUT:-measurements_$VERSION.txt}
+
+export NPARTICLES=${NPARTICLES:-10000}
+export MAXTHREADS=${MAXTHREADS:-$(nproc)}
+
+status=0
+
+{
+  echo "# geant4 $VERSION, $(uname -m), $(nproc) cores, $(date -u +%F)"
+
+  echo "# per step cost of the dispatch, steps with the wrapped safety"
+  bash $SCRIPTS/run_benchmark.sh || status=1
+
+  echo "# events per second from 1 to $MAXTHREADS threads"
+  bash $SCRIPTS/run_scaling.sh || status=1
+
+  echo "# locates per crossing"
+  ./locate_test $NPARTICLES | grep crossings || status=1
+
+  echo "# grazing crossings recovered"
+  ./grazing_test $NPARTICLES | grep crossings || status=1
+
+  echo "# fast forward against cycling"
+  bash $SCRIPTS/run_fast_forward_test.sh || status=1
+
+  echo "# face lookup per crossing"
+  ./face_benchmark | grep crossing || status=1
+
+  echo "# electrons in a magnetic field"
+  for mode in 0 1 2 3; do
+    ./field_benchmark $mode | grep FIELD_BENCHMARK || status=1
+  done
+
+  echo "# optical photons"
+  bash $SCRIPTS/run_optical_test.sh || status=1
+
+  echo "# wedge against the full ring"
+  ./wedge_test | grep deposit || status=1
+} | tee $OUTPUT
+
+exit $status
@@ -0,0 +1,15 @@
+#!/usr/bin/env bash
+# report events per second from 1 to MAXTHREADS threads for each test mode,
+# within a single process per point so that physics tables are shared
+# run from the build directory: bash ../run_scaling.sh
+
+NPARTICLES=${NPARTICLES:-10000}
+MAXTHREADS=${MAXTHREADS:-$(nproc)}
+PARTICLENAME=${PARTICLENAME:-e-}
+TASKS=${TASKS:-0}
+
+for mode in 0 1 2 3; do
+  for threads in $(seq 1 $MAXTHREADS); do
+    ./benchmark $PARTICLENAME $mode $NPARTICLES 1 $threads $TASKS | grep BENCHMARK
+  done
+done
@@ -1,5 +1,5 @@
 #!/usr/bin/env bash
-rm *.hdf5 *.log
+rm *.hdf5 *.log pbc_stats_*.json
 
 NPARTICLES=10000
 NJOBS=4 #assumes you are running on a multi-core machine
@@ -8,7 +8,7 @@ PARTICLENAMES="geantino gamma e- proton neutron"
 # use the parallel utility to parallelise across available cores
 parallel --env NPARTICLES --env NJOBS --env PARTICLENAMES \
 --jobs $NJOBS -q bash -c './test {1} {2} {3} {4} >> {1}.log' \
-::: $PARTICLENAMES ::: $(seq 0 3) ::: $NPARTICLES ::: $(seq 1 $NJOBS)
+::: $PARTICLENAMES ::: $(seq 0 8) ::: $NPARTICLES ::: $(seq 1 $NJOBS)
 
 #run the analysis in parallel
 parallel --env NPARTICLES --env NJOBS --env PARTICLENAMES \
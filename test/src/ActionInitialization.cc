@@ -1,18 +1,29 @@
 #include "ActionInitialization.hh"
 #include "PrimaryGeneratorAction.hh"
+#include "RunAction.hh"
+#include "SteppingAction.hh"
 
-ActionInitialization::ActionInitialization() : G4VUserActionInitialization()
-{}
+ActionInitialization::ActionInitialization(bool count) :
+  G4VUserActionInitialization()
+{
+  count_steps = count;
+}
 
 ActionInitialization::~ActionInitialization()
 {}
 
 void ActionInitialization::BuildForMaster() const
 {
+  //the master takes no steps, the workers report theirs at the end of a run
 }
 
 void ActionInitialization::Build() const
 {
   PrimaryGeneratorAction* primary = new PrimaryGeneratorAction();
   SetUserAction(primary);
+
+  if (count_steps) {
+    SetUserAction(new SteppingAction());
+    SetUserAction(new RunAction());
+  }
 }
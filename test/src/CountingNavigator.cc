@@ -0,0 +1,18 @@
+#include "CountingNavigator.hh"
+
+CountingNavigator::CountingNavigator() : G4Navigator()
+{
+  number_of_locates = 0;
+}
+
+CountingNavigator::~CountingNavigator()
+{}
+
+G4VPhysicalVolume* CountingNavigator::LocateGlobalPointAndSetup(
+  const G4ThreeVector& point, const G4ThreeVector* direction,
+  const G4bool pRelativeSearch, const G4bool ignoreDirection)
+{
+  number_of_locates++;
+  return G4Navigator::LocateGlobalPointAndSetup(point, direction,
+    pRelativeSearch, ignoreDirection);
+}
@@ -4,8 +4,10 @@
 #include "G4Box.hh"
 #include "G4LogicalVolume.hh"
 #include "G4PeriodicBoundaryBuilder.hh"
+#include "G4PeriodicFastForwardModel.hh"
 #include "G4NistManager.hh"
 #include "G4PVPlacement.hh"
+#include "G4RegionStore.hh"
 #include "G4SDManager.hh"
 #include "G4ThreeVector.hh"
 #include "G4VisAttributes.hh"
@@ -48,12 +50,31 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   G4VPhysicalVolume* physical_world = new G4PVPlacement(0, G4ThreeVector(),
     logical_world, "physical_world", 0, false, 0);
 
+  //mode 6 tiles the same lateral extent virtually with a single small cell
+  G4int tiles = (mode == 6) ? 9 : 1;
+
   G4PeriodicBoundaryBuilder* pbb = new G4PeriodicBoundaryBuilder();
-  G4LogicalVolume* logical_cyclic_world = pbb->Construct(logical_world);
+  G4LogicalVolume* logical_cyclic_world = NULL;
+
+  //mode 7 fills the full cell, and reduces it to the quarter on the plus side
+  //of its mirror planes once it is filled
+  if (mode == 7)
+    logical_cyclic_world = new G4LogicalVolume(new G4Box("full_cell",
+      world_xy/2, world_xy/2, world_size_z/2), test_material, "logical_full_cell");
+  else if (mode == 6)
+    logical_cyclic_world = pbb->ConstructArray(logical_world, tiles, tiles);
+  else
+    logical_cyclic_world = pbb->Construct(logical_world);
+
+  //mode 5 fast forwards neutral particles through the cyclic world volume
+  if (mode == 5) pbb->ConstructEnvelope();
+
+  //mode 8 scores in a parallel world instead, see ParallelScorer
+  if (mode == 8) return physical_world;
 
   double scorer_thick = 1*micrometer;
 
-  G4Box* scorer = new G4Box("scorer", world_xy/2.0, world_xy/2.0,
+  G4Box* scorer = new G4Box("scorer", world_xy/2.0/tiles, world_xy/2.0/tiles,
     scorer_thick/2.0);
 
   logical_scorer = new G4LogicalVolume(scorer, test_material, "logical_scorer");
@@ -65,6 +86,9 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
 
   logical_scorer->SetVisAttributes(G4Color::Red());
 
+  if (mode == 7)
+    pbb->ConstructSymmetric(logical_world, logical_cyclic_world, true, true);
+
   return physical_world;
 }
 
@@ -72,8 +96,15 @@ void DetectorConstruction::ConstructSDandField()
 {
   G4SDManager* sd_manager = G4SDManager::GetSDMpointer();
 
-  SensitiveDetector* sd = new SensitiveDetector("scorer_" + run_id);
-  sd_manager->AddNewDetector(sd);
+  if (logical_scorer) {
+    SensitiveDetector* sd = new SensitiveDetector("scorer_" + run_id);
+    sd_manager->AddNewDetector(sd);
+
+    logical_scorer->SetSensitiveDetector(sd);
+  }
 
-  logical_scorer->SetSensitiveDetector(sd);
+  //fast simulation models are built for each thread
+  if (mode == 5)
+    new G4PeriodicFastForwardModel("fast_forward",
+      G4RegionStore::GetInstance()->GetRegion("periodic_envelope"));
 }
@@ -0,0 +1,47 @@
+#include "ParallelScorer.hh"
+#include "SensitiveDetector.hh"
+
+#include "G4Box.hh"
+#include "G4LogicalVolume.hh"
+#include "G4PVPlacement.hh"
+#include "G4SDManager.hh"
+#include "G4ThreeVector.hh"
+
+ParallelScorer::ParallelScorer(G4String world_name, G4String runid, double xy,
+  double z) : G4VUserParallelWorld(world_name)
+{
+  logical_scorer = NULL;
+  run_id = runid;
+  world_xy = xy;
+  world_size_z = z;
+}
+
+ParallelScorer::~ParallelScorer()
+{
+}
+
+void ParallelScorer::Construct()
+{
+  G4LogicalVolume* logical_ghost_world = GetWorld()->GetLogicalVolume();
+
+  double scorer_thick = 1*micrometer;
+
+  G4Box* scorer = new G4Box("scorer", world_xy/2.0, world_xy/2.0,
+    scorer_thick/2.0);
+
+  //the parallel world needs no material
+  logical_scorer = new G4LogicalVolume(scorer, 0, "logical_scorer");
+
+  double z_pos = -world_size_z/2.0 + scorer_thick/2.0;
+
+  new G4PVPlacement(0, G4ThreeVector(0,0,z_pos), logical_scorer,
+    "physical_scorer", logical_ghost_world, false, 0);
+}
+
+void ParallelScorer::ConstructSD()
+{
+  SensitiveDetector* sd = new SensitiveDetector("scorer_" + run_id);
+  G4SDManager::GetSDMpointer()->AddNewDetector(sd);
+
+  SetSensitiveDetector(logical_scorer, sd);
+}
@@ -0,0 +1,19 @@
+#include "RunAction.hh"
+#include "SteppingAction.hh"
+
+#include "G4PeriodicBoundaryPhysics.hh"
+
+RunAction::RunAction() : G4UserRunAction()
+{}
+
+RunAction::~RunAction()
+{}
+
+void RunAction::EndOfRunAction(const G4Run*)
+{
+  SteppingAction::Flush();
+
+  G4PeriodicBoundaryProcess* process =
+    G4PeriodicBoundaryPhysics::GetBoundaryProcess();
+  if (process) process->DumpBudgetStatistics();
+}
@@ -1,20 +1,35 @@
 #include "SensitiveDetector.hh"
 
+#include "G4PeriodicImageInformation.hh"
+#include "G4PeriodicNavigator.hh"
+#include "G4TransportationManager.hh"
 #include "G4RunManager.hh"
 #include "G4VProcess.hh"
 
 #include "G4EventManager.hh"
 #include "G4Event.hh"
+#include "G4AutoLock.hh"
+#include "G4Threading.hh"
+
+namespace {
+    // the HDF5 library is not assumed to be built thread safe
+    G4Mutex hdf5_mutex = G4MUTEX_INITIALIZER;
+}
 
 SensitiveDetector::SensitiveDetector( std::string name)
                  : G4VSensitiveDetector(name)
 {
-    filename = name + ".hdf5";
+    // each worker thread writes its own file
+    filename = name;
+    if (G4Threading::G4GetThreadId() >= 0)
+        filename += "_t" + std::to_string(G4Threading::G4GetThreadId());
+    filename += ".hdf5";
     SetupPacketTable();
 }
 
 SensitiveDetector::~SensitiveDetector()
 {
+    G4AutoLock lock(&hdf5_mutex);
     delete table_;
     H5Fclose(file_);
 }
@@ -32,6 +47,17 @@ bool SensitiveDetector::ProcessHits( G4Step* step
     G4ThreeVector world_position = poststep_point->GetPosition();
     G4ThreeVector direction = track->GetMomentumDirection();
 
+    // Position in the unfolded space, equal to the position without cycling.
+    G4ThreeVector unwrapped_position =
+        G4PeriodicImageInformation::Unwrap(track, world_position);
+
+    // The unfolded navigator tracks in the unfolded space, the position in
+    // the cell is found by wrapping.
+    G4PeriodicNavigator* navigator = dynamic_cast<G4PeriodicNavigator*>(
+        G4TransportationManager::GetTransportationManager()
+        ->GetNavigatorForTracking());
+    if (navigator) world_position = navigator->Wrap(world_position);
+
     // Particle type
     int particle_type = track->GetDefinition()->GetPDGEncoding();
 
@@ -50,9 +76,15 @@ bool SensitiveDetector::ProcessHits( G4Step* step
                     , direction.x()
                     , direction.y()
                     , direction.z()
+                    , unwrapped_position.x()
+                    , unwrapped_position.y()
+                    , unwrapped_position.z()
                     };
 
-    table_->AppendPacket(&packet);
+    {
+        G4AutoLock lock(&hdf5_mutex);
+        table_->AppendPacket(&packet);
+    }
 
     // kill the track once it crosses into the SD to avoid multiple hits
     step->GetTrack()->SetTrackStatus(fStopAndKill);
@@ -62,6 +94,8 @@ bool SensitiveDetector::ProcessHits( G4Step* step
 
 void SensitiveDetector::SetupPacketTable()
 {
+    G4AutoLock lock(&hdf5_mutex);
+
     hid_t table_data_type = H5Tcreate(H5T_COMPOUND, sizeof(Packet));
 
     H5Tinsert(table_data_type, "event"
@@ -108,6 +142,18 @@ void SensitiveDetector::SetupPacketTable()
     , HOFFSET(Packet, direction_z)
     , H5T_NATIVE_DOUBLE);
 
+    H5Tinsert(table_data_type, "unwrapped_x"
+    , HOFFSET(Packet, unwrapped_x)
+    , H5T_NATIVE_DOUBLE);
+
+    H5Tinsert(table_data_type, "unwrapped_y"
+    , HOFFSET(Packet, unwrapped_y)
+    , H5T_NATIVE_DOUBLE);
+
+    H5Tinsert(table_data_type, "unwrapped_z"
+    , HOFFSET(Packet, unwrapped_z)
+    , H5T_NATIVE_DOUBLE);
+
     file_ = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
 
     table_ = new FL_PacketTable(file_, (char*) "data", table_data_type, 1024, 16);
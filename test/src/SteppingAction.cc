@@ -0,0 +1,15 @@
+#include "SteppingAction.hh"
+
+std::atomic<G4long> SteppingAction::number_of_steps(0);
+G4ThreadLocal G4long SteppingAction::thread_steps = 0;
+
+SteppingAction::SteppingAction() : G4UserSteppingAction()
+{}
+
+SteppingAction::~SteppingAction()
+{}
+
+void SteppingAction::UserSteppingAction(const G4Step*)
+{
+  thread_steps++;
+}
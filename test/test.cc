@@ -1,9 +1,12 @@
 #include "ActionInitialization.hh"
+#include "CreateRunManager.hh"
 #include "DetectorConstruction.hh"
+#include "ParallelScorer.hh"
 #include "Shielding.hh"
 
+#include "G4FastSimulationPhysics.hh"
+#include "G4ParallelWorldPhysics.hh"
 #include "G4PeriodicBoundaryPhysics.hh"
-#include "G4RunManager.hh"
 
 #ifdef G4UI_USE
 #include "G4UIExecutive.hh"
@@ -34,7 +37,11 @@ int main(int argc, char** argv)
   if (argc >= 5) job_id = atoi(argv[4]);
   G4cout << "Job id / RNG seed " << job_id << G4endl;
 
-  G4RunManager* run_manager = new G4RunManager();
+  G4int number_of_threads = 1;
+  if (argc >= 6) number_of_threads = atoi(argv[5]);
+  G4cout << "Number of threads " << number_of_threads << G4endl;
+
+  G4RunManager* run_manager = CreateRunManager(number_of_threads);
 
   //seed random number generator according to cmd line argument
   CLHEP::HepRandom::setTheEngine(new CLHEP::RanecuEngine);
@@ -45,17 +52,39 @@ int main(int argc, char** argv)
     std::to_string(job_id);
 
   DetectorConstruction* dc = new DetectorConstruction(run_id, test_mode);
+
+  //mode 8 scores in a parallel world rather than in the periodic world volume
+  if (test_mode == 8)
+    dc->RegisterParallelWorld(new ParallelScorer("scorer_world", run_id,
+      dc->GetWorldXY(), dc->GetWorldZ()));
+
   run_manager->SetUserInitialization(dc);
 
   Shielding* physics_list = new Shielding();
 
+  if (test_mode == 8)
+    physics_list->RegisterPhysics(new G4ParallelWorldPhysics("scorer_world"));
+
   bool use_reflecting = (test_mode == 3);
 
+  //mode 4 tracks through the unfolded lattice instead of cycling
+  G4PeriodicBoundaryMode boundary_mode = (test_mode == 4) ? fPeriodicNavigator
+    : fPeriodicBoundaryProcess;
+
   G4PeriodicBoundaryPhysics* PBC = new G4PeriodicBoundaryPhysics("Cyclic", true,
-    true, false, use_reflecting);
+    true, false, use_reflecting, boundary_mode);
   PBC->SetVerboseLevel(0);
 
-  if ((test_mode == 2) || (test_mode == 3)) physics_list->RegisterPhysics(PBC);
+  if (test_mode >= 2) physics_list->RegisterPhysics(PBC);
+
+  //mode 5 adds fast forwarding of the neutral particles to mode 2
+  if (test_mode == 5) {
+    G4FastSimulationPhysics* fast_simulation = new G4FastSimulationPhysics();
+    fast_simulation->ActivateFastSimulation("geantino");
+    fast_simulation->ActivateFastSimulation("gamma");
+    fast_simulation->ActivateFastSimulation("neutron");
+    physics_list->RegisterPhysics(fast_simulation);
+  }
 
   run_manager->SetUserInitialization(physics_list);
 
@@ -72,8 +101,12 @@ int main(int argc, char** argv)
   double world_xy = dc->GetWorldXY();
   double world_z = dc->GetWorldZ();
 
-  ui_manager->ApplyCommand("/gps/pos/centre 0. 0. " + std::to_string(world_z/2.0)
-  + " mm");
+  //the scorer is uniform laterally, so the source of mode 7 may be moved off
+  //the mirror planes into the middle of the quarter cell
+  double source_xy = (test_mode == 7) ? world_xy/4.0 : 0.;
+
+  ui_manager->ApplyCommand("/gps/pos/centre " + std::to_string(source_xy) + " "
+  + std::to_string(source_xy) + " " + std::to_string(world_z/2.0) + " mm");
 
   bool use_planar_source = false;
   if(use_planar_source){
@@ -86,6 +119,11 @@ int main(int argc, char** argv)
   ui_manager->ApplyCommand("/gps/particle "+particle_name);
 
   if (argc > 1) {
+    //the boundary statistics are printed, and dumped, at the end of the run
+    if (test_mode >= 2)
+      ui_manager->ApplyCommand("/pbc/stats/dumpAtEndOfRun pbc_stats_" + run_id
+        + ".json");
+
     ui_manager->ApplyCommand("/run/beamOn "+std::to_string(number_of_primaries));
   } else {
 
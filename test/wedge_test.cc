@@ -0,0 +1,216 @@
+#include "G4Box.hh"
+#include "G4Event.hh"
+#include "G4Gamma.hh"
+#include "G4LogicalVolume.hh"
+#include "G4NistManager.hh"
+#include "G4ParticleGun.hh"
+#include "G4PeriodicBoundaryBuilder.hh"
+#include "G4PeriodicBoundaryPhysics.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4PVPlacement.hh"
+#include "G4RunManager.hh"
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Tubs.hh"
+#include "G4UserEventAction.hh"
+#include "G4UserSteppingAction.hh"
+#include "G4VUserActionInitialization.hh"
+#include "G4VUserDetectorConstruction.hh"
+#include "G4VUserPrimaryGeneratorAction.hh"
+#include "Randomize.hh"
+#include "Shielding.hh"
+
+#include <cmath>
+
+/*compares a ring of silicon staves with its 1/12 wedge. the full ring of 12
+staves is placed about the origin, and a single stave in a periodic wedge about
+a second axis. events alternate between them, a gamma starting at the same
+point off the axis of each and emitted isotropically. the wedge folds the ring
+onto one stave, so the energy deposited per event in its stave must agree
+with that deposited in all staves of the ring. particles reaching the world
+volume outside either are killed, so that neither sees the other
+
+Usage: ./wedge_test <number_of_primaries>
+
+returns a non-zero exit code if the mean energy deposits differ by more than
+five standard errors, or if any event is aborted, as one leaving the wedge
+through its radii or ends must not be*/
+
+namespace {
+
+const G4int kFold = 12;
+const G4double kRadius = 40*cm;
+const G4double kHalfZ = 30*cm;
+const G4double kStaveRadius = 20*cm;
+const G4ThreeVector kWedgeAxis(2*m, 0, 0);
+const G4ThreeVector kSource(1*cm, 0.2*cm, 0);
+
+//energy deposited per event, and its square, in the ring and in the wedge
+G4double sum[2] = {0., 0.};
+G4double sum2[2] = {0., 0.};
+G4long events[2] = {0, 0};
+G4int aborted[2] = {0, 0};
+G4double deposit = 0.;
+
+class WedgeDetector : public G4VUserDetectorConstruction
+{
+  public:
+    virtual G4VPhysicalVolume* Construct()
+    {
+      G4NistManager* nist = G4NistManager::Instance();
+      G4Material* air = nist->FindOrBuildMaterial("G4_AIR");
+      G4Material* vacuum = nist->FindOrBuildMaterial("G4_Galactic");
+      G4Material* silicon = nist->FindOrBuildMaterial("G4_Si");
+
+      G4LogicalVolume* logical_world = new G4LogicalVolume(
+        new G4Box("world", 3*m, 1*m, 1*m), vacuum, "logical_world");
+      G4VPhysicalVolume* physical_world = new G4PVPlacement(0, G4ThreeVector(),
+        logical_world, "physical_world", 0, false, 0);
+
+      G4LogicalVolume* logical_stave = new G4LogicalVolume(
+        new G4Box("stave", 1*cm, 4*cm, 25*cm), silicon, "logical_stave");
+
+      //the full ring, one stave in each sector
+      G4LogicalVolume* logical_ring = new G4LogicalVolume(
+        new G4Tubs("ring", 0, kRadius, kHalfZ, 0, 360*deg), air, "logical_ring");
+      new G4PVPlacement(0, G4ThreeVector(), logical_ring, "physical_ring",
+        logical_world, false, 0, true);
+
+      for (G4int i = 0; i < kFold; ++i) {
+        G4double phi = i * 360*deg / kFold;
+        G4RotationMatrix* rotation = new G4RotationMatrix();
+        rotation->rotateZ(-phi);
+        new G4PVPlacement(rotation, kStaveRadius*G4ThreeVector(std::cos(phi),
+          std::sin(phi), 0), logical_stave, "physical_stave", logical_ring,
+          false, i, true);
+      }
+
+      //the wedge, bisected by the stave of its one sector
+      G4PeriodicBoundaryBuilder* pbb = new G4PeriodicBoundaryBuilder();
+      G4LogicalVolume* logical_wedge = pbb->ConstructWedge(logical_world, kFold,
+        0, kRadius, kHalfZ, kWedgeAxis);
+      logical_wedge->SetMaterial(air);
+
+      new G4PVPlacement(0, G4ThreeVector(kStaveRadius, 0, 0), logical_stave,
+        "physical_stave", logical_wedge, false, 0, true);
+
+      return physical_world;
+    }
+};
+
+class WedgeGun : public G4VUserPrimaryGeneratorAction
+{
+  public:
+    WedgeGun() : G4VUserPrimaryGeneratorAction()
+    {
+      gun = new G4ParticleGun(1);
+      gun->SetParticleDefinition(G4Gamma::Definition());
+      gun->SetParticleEnergy(2*MeV);
+    }
+
+    virtual ~WedgeGun() { delete gun; }
+
+    virtual void GeneratePrimaries(G4Event* event)
+    {
+      G4double cos_theta = 2*G4UniformRand() - 1;
+      G4double sin_theta = std::sqrt(1 - cos_theta*cos_theta);
+      G4double phi = 2*pi*G4UniformRand();
+
+      //even events in the ring, odd events in the wedge
+      G4ThreeVector axis = (event->GetEventID() % 2) ? kWedgeAxis : G4ThreeVector();
+
+      gun->SetParticlePosition(axis + kSource);
+      gun->SetParticleMomentumDirection(G4ThreeVector(sin_theta*std::cos(phi),
+        sin_theta*std::sin(phi), cos_theta));
+      gun->GeneratePrimaryVertex(event);
+    }
+
+  private:
+    G4ParticleGun* gun;
+};
+
+class StaveDeposit : public G4UserSteppingAction
+{
+  public:
+    virtual void UserSteppingAction(const G4Step* step)
+    {
+      G4VPhysicalVolume* volume = step->GetPreStepPoint()->GetPhysicalVolume();
+      if (!volume) return;
+      if (volume->GetName() == "physical_stave")
+        deposit += step->GetTotalEnergyDeposit();
+      else if (volume->GetName() == "physical_world")
+        step->GetTrack()->SetTrackStatus(fStopAndKill);
+    }
+};
+
+class DepositSum : public G4UserEventAction
+{
+  public:
+    virtual void BeginOfEventAction(const G4Event*) { deposit = 0.; }
+
+    virtual void EndOfEventAction(const G4Event* event)
+    {
+      G4int wedge = event->GetEventID() % 2;
+      if (event->IsAborted()) aborted[wedge]++;
+      sum[wedge] += deposit;
+      sum2[wedge] += deposit*deposit;
+      events[wedge]++;
+    }
+};
+
+class WedgeTestActions : public G4VUserActionInitialization
+{
+  public:
+    virtual void Build() const
+    {
+      SetUserAction(new WedgeGun());
+      SetUserAction(new StaveDeposit());
+      SetUserAction(new DepositSum());
+    }
+};
+
+}
+
+int main(int argc, char** argv)
+{
+
+  G4int number_of_primaries = 100000;
+  if (argc >= 2) number_of_primaries = atoi(argv[1]);
+
+  G4RunManager* run_manager = new G4RunManager();
+
+  run_manager->SetUserInitialization(new WedgeDetector());
+
+  Shielding* physics_list = new Shielding();
+  physics_list->RegisterPhysics(new G4PeriodicBoundaryPhysics("Cyclic"));
+  run_manager->SetUserInitialization(physics_list);
+
+  run_manager->SetUserInitialization(new WedgeTestActions());
+
+  run_manager->Initialize();
+
+  run_manager->BeamOn(2*number_of_primaries);
+
+  G4double mean[2], error[2];
+  for (G4int i = 0; i < 2; ++i) {
+    mean[i] = sum[i] / events[i];
+    error[i] = std::sqrt((sum2[i] / events[i] - mean[i]*mean[i]) / events[i]);
+  }
+
+  G4double difference = std::fabs(mean[0] - mean[1]);
+  G4double sigma = std::sqrt(error[0]*error[0] + error[1]*error[1]);
+
+  G4cout << "mean deposit per event, ring " << mean[0]/keV << " +- "
+    << error[0]/keV << " keV, wedge " << mean[1]/keV << " +- " << error[1]/keV
+    << " keV, difference " << (sigma > 0. ? difference/sigma : 0.)
+    << " standard errors, aborted events, ring " << aborted[0] << ", wedge "
+    << aborted[1] << G4endl;
+
+  G4bool ok = (difference <= 5*sigma && mean[0] > 0. && aborted[0] == 0
+    && aborted[1] == 0);
+
+  delete run_manager;
+
+  return ok ? 0 : 1;
+
+}